@@ -0,0 +1,239 @@
+#include "aggregator.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <iterator>
+
+// space-separated fields of a message
+static std::vector<std::string_view> split(std::string_view message) {
+    std::vector<std::string_view> fields;
+    size_t begin = 0;
+    while (begin < message.size()) {
+        size_t end = message.find(' ', begin);
+        if (end == std::string_view::npos) {
+            end = message.size();
+        }
+        if (end > begin) {
+            fields.push_back(message.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+    return fields;
+}
+
+template <typename T>
+static bool parse(std::string_view field, T* value) {
+    const auto [ptr, ec] = std::from_chars(field.data(), field.data() + field.size(), *value);
+    return ec == std::errc() && ptr == field.data() + field.size();
+}
+
+// ticks from timecode <from> to <to>, picking the rollover count closest to <expected>
+static double unwrap_ticks(uint32_t from, uint32_t to, double expected) {
+    const double raw = std::fmod(static_cast<double>(to) - static_cast<double>(from) + AGGREGATOR_TIMECODE_WRAP, AGGREGATOR_TIMECODE_WRAP);
+    return raw + std::round((expected - raw) / AGGREGATOR_TIMECODE_WRAP) * AGGREGATOR_TIMECODE_WRAP;
+}
+
+SectorAggregator::SectorAggregator(std::vector<std::string> sectors, double _hold_ms)
+    : hold_ms(_hold_ms), inputs(sectors.size()) {
+    for (size_t i = 0; i < sectors.size(); i++) {
+        inputs[i].sector = std::move(sectors[i]);
+    }
+}
+
+double SectorAggregator::to_reference(size_t input, double timestamp) const {
+    if (input == 0) {
+        return timestamp;
+    }
+    if (inputs[input].aligned) {
+        return timestamp - inputs[input].offset;
+    }
+    // via the local clock (which is the timebase until input 0 is heard of)
+    const double reference_rough = inputs[0].rough ? inputs[0].rough_offset : 0.0;
+    return timestamp - inputs[input].rough_offset + reference_rough;
+}
+
+void SectorAggregator::on_message(size_t input, std::string_view message, double local_ms) {
+    const std::vector<std::string_view> fields = split(message);
+    uint64_t timestamp;
+    if (fields.size() < 2 || fields[0].size() != 1 || !parse(fields[1], &timestamp)) {
+        return; // not a timestamped report
+    }
+    Input& in = inputs[input];
+
+    // status and time sync messages are published as soon as they are due:
+    // the best estimate of the decoder's clock from their arrival times.
+    // Passings are published 250+ ms after their timestamp, they would skew it.
+    const double rough_offset = static_cast<double>(timestamp) - local_ms;
+    if (fields[0] == "S" || fields[0] == "T") {
+        if (!in.rough) {
+            in.rough_offset = rough_offset;
+            in.rough = true;
+            for (SectorPassing& passing : in.unplaced) {
+                place(input, std::move(passing));
+            }
+            in.unplaced.clear();
+        } else if (fields[0] == "S") {
+            in.rough_offset += (rough_offset - in.rough_offset) / AGGREGATOR_OFFSET_AVERAGING;
+        }
+    }
+
+    if (fields[0] == "T" && fields.size() >= 5) {
+        uint32_t transponder_id, timecode;
+        if (fields[2] == "OPN" && parse(fields[3], &transponder_id) && parse(fields[4], &timecode)) {
+            on_timesync(input, static_cast<double>(timestamp), transponder_id, timecode, local_ms);
+        }
+    } else if (fields[0] == "P" && fields.size() >= 7) {
+        SectorPassing passing = {};
+        passing.transponder_type = std::string(fields[2]);
+        passing.input = input;
+        if (!parse(fields[3], &passing.transponder_id) || !parse(fields[4], &passing.rssi) ||
+            !parse(fields[5], &passing.hits) || !parse(fields[6], &passing.duration)) {
+            return;
+        }
+        // optional fields of newer decoders
+        if (fields.size() >= 8 && !parse(fields[7], &passing.loop)) {
+            passing.loop = 0;
+        }
+        if (fields.size() >= 9 && !parse(fields[8], &passing.gap)) {
+            passing.gap = 0;
+        }
+        passing.timestamp = static_cast<double>(timestamp);
+        if (!in.rough) {
+            in.unplaced.push_back(std::move(passing)); // until the decoder's clock is estimated
+            return;
+        }
+        place(input, std::move(passing));
+    }
+}
+
+void SectorAggregator::place(size_t input, SectorPassing passing) {
+    passing.timestamp = to_reference(input, passing.timestamp);
+    passing.aligned = (input == 0) || inputs[input].aligned;
+    on_passing(input, std::move(passing));
+}
+
+void SectorAggregator::on_timesync(size_t input, double timestamp, uint32_t transponder_id, uint32_t timecode, double local_ms) {
+    if (input == 0) {
+        // the reference: follow the transponder's timecode and rate
+        auto [it, inserted] = references.try_emplace(transponder_id);
+        Reference& reference = it->second;
+        reference.last_local = local_ms;
+        if (inserted) {
+            reference.timestamp = reference.rate_timestamp = timestamp;
+            reference.timecode = timecode;
+            return;
+        }
+        if (timestamp <= reference.timestamp) {
+            return; // the same time-sync on an other loop
+        }
+        const double elapsed = timestamp - reference.timestamp;
+        const double ticks = unwrap_ticks(reference.timecode, timecode, elapsed * reference.rate);
+        if (ticks <= 0.0 || std::abs(ticks / reference.rate - elapsed) > AGGREGATOR_OUTLIER_MS) {
+            // the transponder restarted; measure its rate again
+            reference.rate_timestamp = timestamp;
+            reference.rate_ticks = 0.0;
+        } else {
+            reference.rate_ticks += ticks;
+            if (timestamp - reference.rate_timestamp >= AGGREGATOR_RATE_MIN_SPAN_MS) {
+                reference.rate = reference.rate_ticks / (timestamp - reference.rate_timestamp);
+            }
+        }
+        reference.timestamp = timestamp;
+        reference.timecode = timecode;
+        return;
+    }
+
+    Input& in = inputs[input];
+    const auto it = references.find(transponder_id);
+    if (it == references.end() || !in.rough || !inputs[0].rough) {
+        return; // input 0 has not seen this transponder (yet)
+    }
+    const Reference& reference = it->second;
+
+    // place the time-sync on the reference's timebase
+    const double guess = in.aligned ? in.offset : in.rough_offset - inputs[0].rough_offset;
+    const double elapsed = (timestamp - guess) - reference.timestamp;
+    if (std::abs(elapsed) > AGGREGATOR_PAIR_MAX_MS) {
+        return; // the transponder's rate is not known well enough to bridge the gap
+    }
+    const double ticks = unwrap_ticks(reference.timecode, timecode, elapsed * reference.rate);
+    const double offset = timestamp - (reference.timestamp + ticks / reference.rate);
+
+    if (!in.aligned) {
+        in.offset = offset;
+        in.aligned = true;
+    } else if (std::abs(offset - in.offset) > AGGREGATOR_OUTLIER_MS) {
+        if (++in.outliers >= AGGREGATOR_OUTLIER_LIMIT) {
+            in.offset = offset; // the decoder restarted
+            in.outliers = 0;
+        }
+    } else {
+        in.outliers = 0;
+        in.offset += (offset - in.offset) / AGGREGATOR_OFFSET_AVERAGING;
+    }
+}
+
+void SectorAggregator::on_passing(size_t input, SectorPassing passing) {
+    Input& in = inputs[input];
+    in.passings++;
+
+    auto same = [this, &passing](const SectorPassing& other) {
+        return inputs[other.input].sector == inputs[passing.input].sector &&
+            other.loop == passing.loop &&
+            other.transponder_id == passing.transponder_id &&
+            other.transponder_type == passing.transponder_type &&
+            std::abs(other.timestamp - passing.timestamp) <= AGGREGATOR_DEDUP_MS;
+    };
+    if (std::any_of(released.begin(), released.end(), same)) {
+        in.duplicates++;
+        return;
+    }
+    const auto duplicate = std::find_if(pending.begin(), pending.end(), same);
+    if (duplicate != pending.end()) {
+        in.duplicates++;
+        if (passing.hits > duplicate->hits) {
+            pending.erase(duplicate); // the better report of the two stays
+        } else {
+            return;
+        }
+    }
+
+    auto position = pending.end();
+    while (position != pending.begin() && std::prev(position)->timestamp > passing.timestamp) {
+        --position;
+    }
+    pending.insert(position, std::move(passing));
+}
+
+std::vector<SectorPassing> SectorAggregator::release(double local_ms) {
+    // the reference's current time, minus the latency of the merged stream
+    const double reference_now = local_ms + (inputs[0].rough ? inputs[0].rough_offset : 0.0);
+    const double watermark = reference_now - hold_ms;
+
+    std::vector<SectorPassing> passings;
+    while (!pending.empty() && pending.front().timestamp <= watermark) {
+        passings.push_back(pending.front());
+        released.push_back(std::move(pending.front()));
+        pending.pop_front();
+    }
+    while (!released.empty() && released.front().timestamp < watermark - AGGREGATOR_DEDUP_MS) {
+        released.pop_front();
+    }
+
+    std::erase_if(references, [local_ms](const auto& entry) {
+        return entry.second.last_local + AGGREGATOR_STALE_MS < local_ms;
+    });
+    return passings;
+}
+
+InputAlignment SectorAggregator::alignment(size_t input) const {
+    const Input& in = inputs[input];
+    const double reference_rough = inputs[0].rough ? inputs[0].rough_offset : 0.0;
+    return {
+        .offset = (input == 0) ? 0.0 : in.aligned ? in.offset : in.rough_offset - reference_rough,
+        .aligned = (input == 0) || in.aligned,
+        .passings = in.passings,
+        .duplicates = in.duplicates
+    };
+}
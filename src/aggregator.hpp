@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#define AGGREGATOR_TICKS_PER_MS 10.0          // transponder timecode: 100 us ticks
+#define AGGREGATOR_TIMECODE_WRAP 1048576.0    // 20 bits
+#define AGGREGATOR_RATE_MIN_SPAN_MS 10000.0   // transponder rate measured over 10+ s
+#define AGGREGATOR_PAIR_MAX_MS 300000.0       // time-syncs further apart are not paired
+#define AGGREGATOR_OFFSET_AVERAGING 8.0       // time-sync pairs
+#define AGGREGATOR_OUTLIER_MS 100.0           // a pair this far off the offset is an outlier...
+#define AGGREGATOR_OUTLIER_LIMIT 5            // ...until this many in a row (ie. a decoder restart)
+#define AGGREGATOR_DEDUP_MS 500.0             // the same passing, reported twice
+#define AGGREGATOR_STALE_MS 600000.0          // transponders not heard of for 10 minutes are forgotten
+
+// a passing on the merged timebase
+struct SectorPassing {
+    double timestamp;       // ms, on the timebase of input 0
+    std::string transponder_type;
+    uint32_t transponder_id;
+    float rssi;
+    uint32_t hits;
+    uint64_t duration;
+    uint32_t loop;          // as reported by the decoder (0 if it does not report loops)
+    uint32_t gap;
+    size_t input;
+    bool aligned;           // false: the decoder's offset is only estimated from arrival times
+};
+
+struct InputAlignment {
+    double offset;          // ms; input timestamp - offset = timestamp on input 0
+    bool aligned;
+    uint64_t passings;
+    uint64_t duplicates;
+};
+
+// Merges the passings of several decoders (sectors) into a single stream.
+//
+// Decoders count time from their own start, on their own clock. The first
+// input is the reference: the others are aligned to it using the OpenStint
+// time-sync frames ("T" messages). A transponder's timecode is a clock shared
+// by every decoder it passes; the rate of each transponder is measured against
+// input 0, so a time-sync heard by input k can be placed on input 0's timebase,
+// even if the transponder crossed input 0 minutes earlier. Until an input is
+// aligned, its offset is estimated from the arrival times of its status and
+// time-sync messages; its passings received before the first of these wait.
+//
+// Passings are held for <hold_ms> (the latency of the merged stream), then
+// released in timestamp order; passings of the same transponder on the same
+// sector within AGGREGATOR_DEDUP_MS are reported once. Not thread-safe.
+class SectorAggregator {
+    struct Input {
+        std::string sector;
+        double rough_offset = 0.0; // decoder time - local time, from arrival times
+        bool rough = false;
+        std::vector<SectorPassing> unplaced; // passings before the first S/T, on the decoder's timebase
+        double offset = 0.0;       // to input 0, from time-syncs
+        bool aligned = false;
+        int outliers = 0;
+        uint64_t passings = 0;
+        uint64_t duplicates = 0;
+    };
+    // a transponder on the reference (input 0)
+    struct Reference {
+        double timestamp = 0.0;    // of the last time-sync, ms
+        uint32_t timecode = 0;
+        double rate_timestamp = 0.0; // start of the current rate measurement
+        double rate_ticks = 0.0;     // ticks elapsed since then
+        double rate = AGGREGATOR_TICKS_PER_MS; // ticks per input 0 ms
+        double last_local = 0.0;
+    };
+
+    const double hold_ms;
+    std::vector<Input> inputs;
+    std::map<uint32_t, Reference> references;
+    std::deque<SectorPassing> pending;  // by timestamp
+    std::deque<SectorPassing> released; // the last AGGREGATOR_DEDUP_MS, for de-duplication
+
+    double to_reference(size_t input, double timestamp) const;
+    void on_timesync(size_t input, double timestamp, uint32_t transponder_id, uint32_t timecode, double local_ms);
+    // convert <passing> (on the decoder's timebase) to the reference's, and queue it
+    void place(size_t input, SectorPassing passing);
+    void on_passing(size_t input, SectorPassing passing);
+
+public:
+    SectorAggregator(std::vector<std::string> sectors, double hold_ms);
+
+    // a message of a decoder, received at <local_ms> (steady clock)
+    void on_message(size_t input, std::string_view message, double local_ms);
+    // passings older than the hold time, in timestamp order
+    std::vector<SectorPassing> release(double local_ms);
+
+    const std::string& sector(size_t input) const { return inputs[input].sector; }
+    InputAlignment alignment(size_t input) const;
+    size_t input_count() const { return inputs.size(); }
+};
@@ -0,0 +1,294 @@
+// Microbenchmarks of the DSP and decoding kernels.
+//
+// Self-contained harness: every kernel runs on synthetic data for a fixed
+// time budget, and the mean cost is reported per sample, per frame or per
+// call. Per-sample kernels are also compared to the real-time budget of the
+// sample rate this binary was built for (SAMPLES_PER_SYMBOL).
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "frame.hpp"
+#include "transponder.hpp"
+#include "passing.hpp"
+#include "rc4.hpp"
+#include "generator.hpp"
+
+#define BENCH_MIN_SECONDS 0.5
+#define BENCH_FRAME_COUNT 64
+#define BENCH_FRAME_GAP_SYMBOLS 200 // silence between frames
+#define BENCH_AMPLITUDE 80.0f
+#define BENCH_NOISE_SIGMA 4.0f
+
+using namespace std::chrono;
+
+// keep the optimizer from discarding results
+template <typename T>
+static inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// run body() repeatedly for BENCH_MIN_SECONDS; body processes <items> items per call
+static double measure(const std::function<void()>& body, size_t items) {
+    body(); // warm up caches, allocations
+    size_t iterations = 0;
+    const auto start = steady_clock::now();
+    auto now = start;
+    while (iterations < 3 || duration<double>(now - start).count() < BENCH_MIN_SECONDS) {
+        body();
+        iterations++;
+        now = steady_clock::now();
+    }
+    return duration<double, std::nano>(now - start).count() / static_cast<double>(iterations * items);
+}
+
+static void report(const char* name, double ns, const char* unit) {
+    std::printf("%-48s %12.2f  %s\n", name, ns, unit);
+}
+
+static void report_per_sample(const char* name, double ns) {
+    const double budget_ns = 1e9 / SAMPLE_RATE;
+    std::printf("%-48s %12.2f  ns/sample  (%.1fx real time)\n", name, ns, budget_ns / ns);
+}
+
+static std::mt19937 rng(42);
+
+static std::complex<int8_t> quantize(std::complex<float> s) {
+    auto q = [](float x) { return static_cast<int8_t>(std::clamp(std::lround(x), -127l, 127l)); };
+    return { q(s.real()), q(s.imag()) };
+}
+
+static std::vector<std::complex<int8_t>> noise(size_t sample_count) {
+    std::normal_distribution<float> n(0.0f, BENCH_NOISE_SIGMA);
+    std::vector<std::complex<int8_t>> samples(sample_count);
+    for (auto& s : samples) {
+        s = quantize({ n(rng), n(rng) });
+    }
+    return samples;
+}
+
+// A train of frames of the given protocol with random payload, separated by
+// noise. Frames start at frame_starts (sample index of the first init symbol).
+struct FrameTrain {
+    std::vector<std::complex<int8_t>> samples;
+    std::vector<size_t> frame_starts;
+};
+
+static FrameTrain frame_train(TransponderProtocol protocol) {
+    const auto& props = transponder_props(protocol);
+    const size_t frame_symbols = GENERATOR_INIT_SYMBOLS + PREAMBLE_LENGTH + props.payload_size + GENERATOR_TAIL_SYMBOLS;
+    const size_t stride = (frame_symbols + BENCH_FRAME_GAP_SYMBOLS) * SAMPLES_PER_SYMBOL;
+
+    GeneratorConfig config;
+    config.noise = 10.0f * std::log10(2.0f * BENCH_NOISE_SIGMA * BENCH_NOISE_SIGMA / (ADC_FULL_SCALE * ADC_FULL_SCALE));
+    GeneratedTransponder transponder;
+    transponder.protocol = protocol;
+    transponder.transponder_id = 1234567;
+    transponder.rssi = 20.0f * std::log10(BENCH_AMPLITUDE / ADC_FULL_SCALE);
+    transponder.frame_interval = static_cast<double>(stride) / SAMPLE_RATE;
+    transponder.frame_jitter = 0.0;
+    config.transponders.push_back(transponder);
+
+    SignalGenerator generator(config);
+    FrameTrain train;
+    train.samples.resize((BENCH_FRAME_COUNT + 1) * stride);
+    generator.generate_cs8(train.samples.data(), train.samples.size());
+    for (const auto& frame : generator.take_frames()) {
+        const size_t start = frame.timecode - GENERATOR_INIT_SYMBOLS * SAMPLES_PER_SYMBOL;
+        if (start + stride <= train.samples.size()) {
+            train.frame_starts.push_back(start);
+        }
+    }
+    return train;
+}
+
+// sample index right after the preamble and the EQ's trailing context, as in detect_frames()
+static int preamble_end(size_t frame_start) {
+    return static_cast<int>(frame_start) + (GENERATOR_INIT_SYMBOLS + PREAMBLE_LENGTH + SymbolWindow::fseq_halflen) * SAMPLES_PER_SYMBOL;
+}
+
+static void bench_frame_detector() {
+    const auto samples = noise(1 << 20);
+    FrameDetector<SAMPLES_PER_SYMBOL> detector;
+    const double ns_noise = measure([&] {
+        for (size_t i = 0; i + SAMPLES_PER_SYMBOL <= samples.size(); i += SAMPLES_PER_SYMBOL) {
+            keep(detector.process_baseband(samples.data() + i));
+        }
+    }, samples.size());
+    report_per_sample("FrameDetector::process_baseband/noise", ns_noise);
+
+    for (auto protocol : { TransponderProtocol::OpenStint, TransponderProtocol::RC4 }) {
+        const FrameTrain train = frame_train(protocol);
+        size_t detections = 0;
+        const double ns = measure([&] {
+            for (size_t i = 0; i + SAMPLES_PER_SYMBOL <= train.samples.size(); i += SAMPLES_PER_SYMBOL) {
+                detections += detector.process_baseband(train.samples.data() + i).has_value();
+            }
+        }, train.samples.size());
+        const std::string name = std::string("FrameDetector::process_baseband/frames_")
+            + std::string(transponder_props(protocol).prefix);
+        report_per_sample(name.c_str(), ns);
+        keep(detections);
+    }
+}
+
+static void bench_symbol_reader() {
+    const FrameTrain train = frame_train(TransponderProtocol::OpenStint);
+    SymbolReader<SAMPLES_PER_SYMBOL> reader;
+    const std::complex<float> dc_offset(0.0f, 0.0f);
+    Frame frame;
+
+    const double ns_train = measure([&] {
+        for (size_t start : train.frame_starts) {
+            frame = Frame(TransponderProtocol::OpenStint, 1.0f, 0, 0);
+            reader.train_preamble(&frame, train.samples.data(), preamble_end(start), dc_offset);
+        }
+    }, train.frame_starts.size());
+    report("SymbolReader::train_preamble", ns_train, "ns/frame");
+
+    size_t symbol_count = 0;
+    const double ns_read = measure([&] {
+        for (size_t start : train.frame_starts) {
+            const int end = preamble_end(start);
+            frame = Frame(TransponderProtocol::OpenStint, 1.0f, 0, 0);
+            reader.train_preamble(&frame, train.samples.data(), end, dc_offset);
+            reader.read_preamble(&frame, train.samples.data(), end, dc_offset);
+            for (size_t i = end; !reader.is_frame_complete(&frame) && i + SAMPLES_PER_SYMBOL <= train.samples.size(); i += SAMPLES_PER_SYMBOL) {
+                reader.read_symbol(&frame, train.samples.data() + i, dc_offset);
+            }
+            symbol_count += frame.symbols.size();
+        }
+    }, train.frame_starts.size());
+    report("SymbolReader::train+read_preamble+read_symbol", ns_read, "ns/frame");
+    keep(symbol_count);
+
+    // read_symbol alone, over a long stretch of samples
+    const size_t symbols_per_frame = 128;
+    const double ns_symbol = measure([&] {
+        for (size_t start : train.frame_starts) {
+            frame = Frame(TransponderProtocol::OpenStint, 1.0f, 0, 0);
+            frame.symbol_scale = 1.0f / BENCH_AMPLITUDE;
+            for (size_t s = 0; s < symbols_per_frame; s++) {
+                reader.read_symbol(&frame, train.samples.data() + start + s * SAMPLES_PER_SYMBOL, dc_offset);
+            }
+        }
+    }, train.frame_starts.size() * symbols_per_frame * SAMPLES_PER_SYMBOL);
+    report_per_sample("SymbolReader::read_symbol", ns_symbol);
+}
+
+static void bench_decoders() {
+    std::uniform_int_distribution<uint32_t> ids(0, 9999999);
+    std::vector<std::vector<uint8_t>> openstint(BENCH_FRAME_COUNT, std::vector<uint8_t>(80));
+    std::vector<std::vector<uint8_t>> rc3(BENCH_FRAME_COUNT, std::vector<uint8_t>(80));
+    for (size_t i = 0; i < BENCH_FRAME_COUNT; i++) {
+        encode_openstint(ids(rng), openstint[i].data());
+        encode_rc3(ids(rng), 0x00, rc3[i].data());
+    }
+
+    uint32_t transponder_id;
+    const double ns_openstint = measure([&] {
+        for (const auto& softbits : openstint) {
+            keep(decode_openstint(softbits.data(), &transponder_id));
+        }
+    }, openstint.size());
+    report("decode_openstint", ns_openstint, "ns/frame");
+
+    uint8_t status_code;
+    const double ns_rc3 = measure([&] {
+        for (const auto& softbits : rc3) {
+            keep(decode_rc3(softbits.data(), &transponder_id, &status_code));
+        }
+    }, rc3.size());
+    report("decode_rc3", ns_rc3, "ns/frame");
+
+    std::vector<uint64_t> payloads(BENCH_FRAME_COUNT);
+    std::vector<std::vector<uint8_t>> rc4(BENCH_FRAME_COUNT, std::vector<uint8_t>(100));
+    std::uniform_int_distribution<uint64_t> u64;
+    for (size_t i = 0; i < payloads.size(); i++) {
+        payloads[i] = u64(rng);
+        encode_rc4(payloads[i], rc4[i].data());
+    }
+    const double ns_rc4 = measure([&] {
+        for (const auto& softbits : rc4) {
+            keep(RC4Message(softbits.data()).is_valid);
+        }
+    }, rc4.size());
+    report("RC4Message", ns_rc4, "ns/frame");
+
+    // a busy club: 500 transponders, ~64 codes each
+    RC4Registry registry;
+    std::vector<uint64_t> known;
+    for (uint32_t t = 0; t < 500; t++) {
+        std::vector<uint64_t> codes(64);
+        std::generate(codes.begin(), codes.end(), [&] { return u64(rng); });
+        registry.store(0, codes);
+        known.insert(known.end(), codes.begin(), codes.begin() + 2);
+    }
+    std::shuffle(known.begin(), known.end(), rng);
+    const double ns_lookup = measure([&] {
+        for (uint64_t payload : known) {
+            keep(registry.lookup(payload, &transponder_id));
+        }
+    }, known.size());
+    report("RC4Registry::lookup", ns_lookup, "ns/frame");
+}
+
+// RSSI of a transponder crossing the loop: two lobes around a null
+static std::deque<Detection> passing_detections(size_t count) {
+    std::normal_distribution<float> n(0.0f, 1.0f);
+    std::deque<Detection> detections;
+    const uint64_t timecode_step = SAMPLE_RATE / 1000; // ~1 kHz frame rate
+    for (size_t i = 0; i < count; i++) {
+        const float x = 4.0f * (static_cast<float>(i) / count - 0.5f);
+        const float rssi = -40.0f + 20.0f * std::exp(-x * x) - 12.0f * std::exp(-16.0f * x * x) + n(rng);
+        const uint64_t timecode = i * timecode_step;
+        detections.emplace_back(timecode * 1000000ull / SAMPLE_RATE, timecode, rssi);
+    }
+    return detections;
+}
+
+static void bench_passing() {
+    // PassingDetector::append, spread over 32 transponders
+    const size_t appends = 4096;
+    std::vector<Detection> detections;
+    for (size_t i = 0; i < appends; i++) {
+        detections.emplace_back(i * 1000, i * (SAMPLE_RATE / 1000), -20.0f);
+    }
+    const double ns_append = measure([&] {
+        auto detector = std::make_unique<PassingDetector>(SAMPLE_RATE);
+        for (size_t i = 0; i < appends; i++) {
+            detector->append({ TransponderSystem::AMB, static_cast<uint32_t>(1000 + (i % 32)) }, detections[i]);
+        }
+    }, appends);
+    report("PassingDetector::append", ns_append, "ns/frame");
+
+    for (size_t count : { 16u, 100u, 4096u }) {
+        const auto detections = passing_detections(count);
+        const double ns = measure([&] {
+            keep(compute_passing_point(detections, SAMPLE_RATE).weighted_timestamp);
+        }, 1);
+        const std::string name = "compute_passing_point/" + std::to_string(count);
+        report(name.c_str(), ns, "ns/passing");
+    }
+}
+
+int main() {
+    init_transponders();
+
+    std::printf("openstint_bench: SAMPLES_PER_SYMBOL=%d, sample rate %d S/s\n\n", SAMPLES_PER_SYMBOL, SAMPLE_RATE);
+    bench_frame_detector();
+    bench_symbol_reader();
+    bench_decoders();
+    bench_passing();
+    return 0;
+}
@@ -1,14 +1,20 @@
 #include "commons.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <complex>
 #include <format>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
-#include <zmq.hpp>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #include "crash_handler.hpp"
 #include "preamble.hpp"
@@ -17,167 +23,75 @@
 #include "passing.hpp"
 #include "counters.hpp"
 #include "rc4.hpp"
+#include "pipeline.hpp"
+#include "timebase.hpp"
+#include "publisher.hpp"
+#include "journal.hpp"
+#include "shm_ring.hpp"
+#include "frame_record.hpp"
+#include "logger.hpp"
+
+#define DRIFT_REPORTING_PERIOD_US 5000000
 
 using namespace std::chrono;
 
 static int zmq_port = DEFAULT_ZEROMQ_PORT;
-static zmq::context_t* zmq_context = nullptr;
-static zmq::socket_t* publisher = nullptr;
-
-static enum FrameParseMode { FRAME_SEEK, FRAME_WAIT, FRAME_FOUND } frame_parse_mode = FRAME_SEEK;
-static int pending_trail = 0; // symbols left to wait before the centered EQ window is full
-static FrameDetector frame_detector;
-static SymbolReader symbol_reader;
-static Frame frame;
-static PassingDetector passing_detector;
-static RxStatistics rx_stats;
+static std::unique_ptr<Publisher> publisher;
+static bool quiet_mode = false;
+static int journal_port = DEFAULT_JOURNAL_PORT;
+static std::string journal_file;
+static Journal journal;
+static std::unique_ptr<JournalServer> journal_server;
+static std::string shm_name;
+static ShmRingWriter shm_ring;
+
 static bool monitor_mode = false;
+static FrameRecorder frame_recorder;
+static int frame_record_port = 0;
+static std::string frame_record_file;
+static uint32_t frame_record_fields = FRAME_FIELDS_DEFAULT;
 static const uint64_t startup_ts = duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
 static bool mode_sysclk = false;
-static uint64_t timecode = 0ul;
+static bool mode_drift_corrected = false;
+static DriftEstimator drift_estimator; // against the OpenStint time-sync frames of every loop
+static uint64_t drift_reported_ts = 0;
+static bool mode_offline = false;
 
 static std::string storage_dir = ".";
 static std::unique_ptr<RC4FileBasedRegistry> rc4_registry;
-static RC4Trainer rc4_trainer;
-static AmbRcBlacklist ambrc_blacklist;
 
-bool process_frame(Frame* frame) {
-    if (monitor_mode) {
-        std::cout << "F " << *frame << std::endl;
-    }
-
-    const uint8_t *softbits = frame->bits();
-    if (!softbits) {
-        // preamble not found
-        return false;
-    }
+// one pipeline per loop, all on the same timebase (startup_ts)
+static std::vector<std::unique_ptr<EventSink>> report_sinks;
+static std::vector<std::unique_ptr<DecoderPipeline>> pipelines;
+static std::mutex frame_recorder_mutex; // frames of every loop go to the same recorder
 
-    uint32_t transponder_id;
-    switch (frame->transponder_protocol) {
-        case TransponderProtocol::OpenStint:
-        if (decode_openstint(softbits, &transponder_id)) {
-            if (transponder_id < 10000000u) {
-                passing_detector.append(frame, transponder_id);
-            } else if ((transponder_id & 0x00A00000) == 0x00A00000) {
-                uint32_t transponder_timestamp = (transponder_id & 0x000FFFFF);
-                passing_detector.timesync(frame, transponder_timestamp);
-            }
-            return true;
-        }
-        break;
-        case TransponderProtocol::RC3: {
-            uint8_t status_code;
-            if (decode_rc3(softbits, &transponder_id, &status_code)) {
-                if (transponder_id >= 10000000) { // not a 7-digit transponder for sure
-                    // check for known status/validation message (to track some statistics)
-                    return ((status_code & 0x07) == 0); 
-                }
-                // status byte:
-                // https://www.rctech.net/forum/showpost.php?p=16244070&postcount=1171
-                // RC4 hybrid and "recent" RC3 indicate status messages in lower 3 bits (0x07 mask)
-                // Older RC3 indicate normal messages by setting all bits 1 (0xff)
-                
-                // Old AMBRc DP transponders send *transponder* frames with all status bits set (0xff);
-                // unfortunately newer models can transmit RC3 status/validation messages the same way.
-                // Let's build a block-list for such transponders.
-                ambrc_blacklist.process(frame->timestamp, status_code, transponder_id);
-                if (status_code == 0xff && !ambrc_blacklist.check_banned(transponder_id)) {
-                    passing_detector.append(frame, transponder_id);
-                } else if ((status_code & 0x07) == 0) { // not a status/validation message for sure
-                    passing_detector.append(frame, transponder_id);
-                }
-                // at this point decoding was success; if status byte indicates
-                // non-transponder message, it should not screw decoded statistics
-                return true;
-            }
-        }
-        break;
-        case TransponderProtocol::RC4: {
-            RC4Message msg(softbits);
-            if (!msg.is_valid) { // fails validation
-                return false;
-            }
-            if (rc4_registry->lookup(msg.payload, &transponder_id)) {
-                passing_detector.append(frame, transponder_id);
-                rc4_trainer.append(frame->timestamp, frame->rssi(), transponder_id, msg.payload);
-                return true;
-            }
-            rc4_trainer.append(frame->timestamp, frame->rssi(), 0, msg.payload);
-            return true;
-        }
-    }
-    return false;
+bool offline_mode() {
+    return mode_offline;
 }
 
-void detect_frames(const std::complex<int8_t>* samples, std::size_t sample_count) {
-    const uint64_t timestamp = duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count() - startup_ts;
-
-    // on USB hiccup, there might be a super-small buffer, which can not even fit
-    // the preamble; these buffers should be dropped as bougus to prevent indexing
-    // issues later on.
-    if (sample_count < SymbolReader::reserve_buffer_size) {
-        timecode += sample_count;
-        return; // no meaningful work here
+void skip_samples(std::size_t sample_count) {
+    for (auto& pipeline : pipelines) {
+        pipeline->skip(sample_count);
     }
+}
 
-    bool frame_detected = false;
-    for (uint32_t idx=0; (idx+SAMPLES_PER_SYMBOL)<=sample_count; idx+=SAMPLES_PER_SYMBOL) {
-        if (frame_parse_mode == FRAME_SEEK) {
-            const std::optional<DetectionResult> detected = frame_detector.process_baseband(samples+idx);
-            if (detected) {
-                frame_parse_mode = FRAME_WAIT;
-                frame_detected = true; // do not use this buffer for noisefloor calculation
-                frame = Frame(
-                    detected.value().first,
-                    detected.value().second,
-                    timestamp + (static_cast<uint64_t>(idx) * 1000000ull / SAMPLE_RATE), // "UL" on windows is 4 bytes :o
-                    timecode + idx
-                );
-                // defer training by fseq_halflen symbols: the centered EQ needs the
-                // trailing (future) symbols, which become ordinary past samples once
-                // they arrive. timing stays anchored at this detection point.
-                pending_trail = SymbolReader::fseq_halflen;
-            }
-        } else if (frame_parse_mode == FRAME_WAIT) {
-            // count the trailing symbols of the centered EQ window; once they are in,
-            // train/read the preamble looking both back (lead) and ahead (trailing).
-            if (--pending_trail == 0) {
-                const int end = idx + SAMPLES_PER_SYMBOL;
-                symbol_reader.train_preamble(&frame, samples, end, frame_detector.dc_offset());
-                symbol_reader.read_preamble(&frame, samples, end, frame_detector.dc_offset());
-                frame_parse_mode = FRAME_FOUND;
-            }
-        } else if (frame_parse_mode == FRAME_FOUND) {
-            symbol_reader.read_symbol(&frame, samples+idx, frame_detector.dc_offset());
-            if (symbol_reader.is_frame_complete(&frame)) {
-                frame_parse_mode = FRAME_SEEK;
-                bool frame_processed = process_frame(&frame);
-                rx_stats.register_frame(frame_processed);
-            }
-        }
-    }
-
-    // update global sample counter
-    timecode += sample_count;
-
-    // save a small section of the buffer
-    // if there is a frame in the next buffer, and read_preamble() must
-    // look back, here save the trailing section of the current buffer
-    symbol_reader.update_reserve_buffer(samples, sample_count);
+void detect_frames(const std::complex<int8_t>* samples, std::size_t sample_count, std::size_t loop, std::size_t input) {
+    pipelines[loop]->process(samples, sample_count, input);
+}
 
-    // update counters for noise energy and dc offset
-    if (frame_detected) {
-        // there was an active frame in the buffer, do not update
-        // statistics, as the received data messes with the
-        // noise/dc-offset calculation
-        frame_detector.reset_statistics_counters();
-    } else {
-        frame_detector.update_statistics();
-        rx_stats.save_channel_characteristics(
-            frame_detector.dc_offset(),
-            frame_detector.noise_energy()
-        );
+void pin_thread_to_core(std::size_t thread_index) {
+#ifdef __linux__
+    // spread the radios' DSP threads over the cores, one each
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(thread_index % cores, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0) {
+        log_err("Failed to pin DSP thread {} to a core", thread_index);
     }
+#else
+    (void)thread_index; // left to the OS scheduler
+#endif
 }
 
 bool parse_common_arguments(int& i, const int argc, const std::string& arg, char** argv) {
@@ -185,8 +99,26 @@ bool parse_common_arguments(int& i, const int argc, const std::string& arg, char
         zmq_port = std::atoi(argv[++i]);
     } else if (arg == "-m") {
         monitor_mode = true;
+    } else if (arg == "-f" && i + 1 < argc) {
+        frame_record_port = std::atoi(argv[++i]);
+    } else if (arg == "-F" && i + 1 < argc) {
+        frame_record_file = argv[++i];
+    } else if (arg == "-M" && i + 1 < argc) {
+        frame_record_fields = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));
+    } else if (arg == "-j" && i + 1 < argc) {
+        journal_port = std::atoi(argv[++i]);
+    } else if (arg == "-J" && i + 1 < argc) {
+        journal_file = argv[++i];
+    } else if (arg == "-S" && i + 1 < argc) {
+        shm_name = argv[++i];
+    } else if (arg == "-q") {
+        quiet_mode = true;
     } else if (arg == "-t") {
         mode_sysclk = true;
+    } else if (arg == "-r") {
+        mode_drift_corrected = true;
+    } else if (arg == "-x") {
+        mode_offline = true;
     } else if (arg == "-s" && i + 1 < argc) {
         storage_dir = argv[++i];
     } else {
@@ -195,117 +127,274 @@ bool parse_common_arguments(int& i, const int argc, const std::string& arg, char
     return true;
 }
 
-void init_commons() {
+uint64_t reporting_timestamp(uint64_t timestamp_us, uint64_t steady_now, uint64_t sysclk_now) {
+    if (mode_sysclk) {
+        return (sysclk_now - (steady_now - timestamp_us))/1000ul;
+    } else {
+        return timestamp_us/1000ul;
+    }
+}
+
+// pipeline timestamp (us) -> reported timestamp (ms)
+static uint64_t reporting_timestamp(uint64_t timestamp_us, const DecoderPipeline& pipeline) {
+    if (mode_drift_corrected) {
+        return drift_estimator.correct(timestamp_us) / 1000ul;
+    }
+    const uint64_t now_ts = pipeline.now();
+    // the virtual clock has no wall-clock equivalent, -t does not apply offline
+    const uint64_t now_sysclk = mode_offline ? now_ts
+        : duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    return reporting_timestamp(timestamp_us, now_ts, now_sysclk);
+}
+
+// Emit a report to the console, to the journal and to the ZeroMQ clients subscribed
+// to its topic. The timestamp (ms) is what the journal indexes the report by.
+// The journal sequence number is appended to the report: it is the SINCE of
+// a client catching up after a reconnect. Every report is journaled, even if
+// nobody listens: that is when clients miss them.
+template <typename Formatter>
+static void publish(char topic, uint64_t timestamp, Formatter&& format) {
+    const bool subscribed = publisher->is_subscribed(topic);
+
+    std::string report = format();
+    std::format_to(std::back_inserter(report), " {}", journal.last_seq() + 1);
+    journal.append(timestamp, report);
+    if (!quiet_mode) {
+        log_out("{}", report);
+    }
+    if (subscribed) {
+        publisher->send(report);
+    }
+}
+
+// pipeline events -> console, journal, ZeroMQ, shared memory and frame records.
+// Reports are tagged with the loop they come from. Every field has a fixed
+// position per message type (docs/decoder-protocol.md): new fields go after
+// the existing ones, so consumers parse by position, not by "last field".
+class ReportSink : public EventSink {
+    const size_t loop;
+
+    uint64_t reporting_timestamp(uint64_t timestamp_us) const {
+        return ::reporting_timestamp(timestamp_us, *pipelines[loop]);
+    }
+
+public:
+    explicit ReportSink(size_t _loop) : loop(_loop) {}
+
+    void on_frame(const Frame& frame, FrameOutcome outcome) override {
+        if (monitor_mode) {
+            log_out("F {}", frame);
+        }
+        if (frame_recorder.is_enabled()) {
+            std::lock_guard<std::mutex> lock(frame_recorder_mutex);
+            frame_recorder.write(frame, outcome, static_cast<uint8_t>(loop));
+        }
+    }
+
+    void on_status(uint64_t timestamp_us, const RxStatus& status) override {
+        const uint64_t timestamp = reporting_timestamp(timestamp_us);
+        publish('S', timestamp, [&] {
+            return std::format("S {} {:.2f} {:.2f} {} {} {} {:.2f} {:.0f} {} {} {:.3f} {:.3f} {:.3f} {}",
+                timestamp,
+                status.noise_floor,
+                status.dc_offset,
+                status.frames_received,
+                status.frames_processed,
+                loop,
+                status.clock_ppm,
+                status.clock_jitter,
+                status.drops,
+                status.lost_samples,
+                status.preamble_thresholds[static_cast<int>(TransponderProtocol::OpenStint)],
+                status.preamble_thresholds[static_cast<int>(TransponderProtocol::RC3)],
+                status.preamble_thresholds[static_cast<int>(TransponderProtocol::RC4)],
+                status.frames_aborted
+            );
+        });
+        if (shm_ring.is_open()) {
+            shm_ring.write_status(static_cast<uint32_t>(loop), {
+                .timestamp = timestamp,
+                .noise_power = status.noise_floor,
+                .dc_offset = status.dc_offset,
+                .frames_received = status.frames_received,
+                .frames_processed = status.frames_processed
+            });
+        }
+    }
+
+    void on_timesync(const TimeSync& time_sync) override {
+        drift_estimator.add(time_sync);
+        const uint64_t timestamp = reporting_timestamp(time_sync.timestamp);
+        publish('T', timestamp, [&] {
+            return std::format("T {} {} {} {} {}",
+                timestamp,
+                transponder_system_name(time_sync.transponder_type), // always openstint
+                time_sync.transponder_id,
+                time_sync.transponder_timestamp,
+                loop
+            );
+        });
+        shm_ring.write_timesync(static_cast<uint32_t>(loop), {
+            .timestamp = timestamp,
+            .transponder_system = static_cast<uint32_t>(time_sync.transponder_type),
+            .transponder_id = time_sync.transponder_id,
+            .transponder_timestamp = time_sync.transponder_timestamp
+        });
+    }
+
+    void on_passing(const Passing& passing) override {
+        const uint64_t timestamp = reporting_timestamp(passing.timestamp);
+        publish('P', timestamp, [&] {
+            return std::format("P {} {} {} {:.2f} {} {} {} {}",
+                timestamp,
+                transponder_system_name(passing.transponder_type),
+                passing.transponder_id,
+                passing.rssi,
+                passing.hits,
+                passing.duration,
+                loop,
+                passing.gap ? 1 : 0
+            );
+        });
+        shm_ring.write_passing(static_cast<uint32_t>(loop), {
+            .timestamp = timestamp,
+            .duration = passing.duration,
+            .transponder_system = static_cast<uint32_t>(passing.transponder_type),
+            .transponder_id = passing.transponder_id,
+            .rssi = passing.rssi,
+            .hits = static_cast<uint32_t>(passing.hits),
+            .gap = passing.gap ? 1u : 0u
+        });
+    }
+
+    void on_learning(uint64_t timestamp_us, const LearningEvent& event) override {
+        const uint64_t timestamp = reporting_timestamp(timestamp_us);
+        switch (event.result) {
+            case RC4Trainer::EvaluationResult::START:
+            publish('L', timestamp, [&] { return std::format("L {} START {:.1f} {} {}", timestamp, event.rssi, loop, event.session); });
+            break;
+            case RC4Trainer::EvaluationResult::INTERRUPED:
+            publish('L', timestamp, [&] { return std::format("L {} INTERRUPTED {} {}", timestamp, loop, event.session); });
+            break;
+            case RC4Trainer::EvaluationResult::DONE:
+            publish('L', timestamp, [&] { return std::format("L {} DONE {} {} {} {}", timestamp, event.transponder_id, event.payload_count, loop, event.session); });
+            break;
+            case RC4Trainer::EvaluationResult::RESET:
+            publish('L', timestamp, [&] { return std::format("L {} RESET {} {}", timestamp, loop, event.session); });
+            break;
+            case RC4Trainer::EvaluationResult::NO_ACTION:
+            break;
+        }
+    }
+};
+
+void init_commons(const std::vector<std::size_t>& loop_inputs, int samples_per_symbol) {
     install_crash_handler();
 
+    if (mode_sysclk && mode_drift_corrected) {
+        log_err("-t and -r are exclusive: pick one timebase");
+        std::exit(EXIT_FAILURE);
+    }
+
+    // offline processing runs ahead of the console; nothing may be lost there
+    if (mode_offline) {
+        AsyncLogger::instance().set_lossless(true);
+    }
+
     // transponder processing (allocate viterbi trellis); TODO RAII
     init_transponders();
 
     //  Prepare our context and publisher
     std::string zmq_address;
     std::format_to(std::back_inserter(zmq_address), "tcp://*:{}", zmq_port);
-    zmq_context = new zmq::context_t(1);
-    publisher = new zmq::socket_t(*zmq_context, zmq::socket_type::pub);
-    publisher->bind(zmq_address);
-    std::cout << "Listening on " << zmq_address << std::endl;
+    publisher = std::make_unique<Publisher>(zmq_address);
+    log_out("Listening on {}", zmq_address);
+
+    // catch-up endpoint for clients which missed messages
+    if (!journal_file.empty() && !journal.open(journal_file)) {
+        log_err("Failed to open journal '{}'", journal_file);
+        std::exit(EXIT_FAILURE);
+    }
+    std::string journal_address;
+    std::format_to(std::back_inserter(journal_address), "tcp://*:{}", journal_port);
+    journal_server = std::make_unique<JournalServer>(journal_address, journal);
+    log_out("Journal listening on {}", journal_address);
+
+    // optional output for consumers on the same host
+    if (!shm_name.empty()) {
+        if (!shm_ring.open(shm_name)) {
+            std::exit(EXIT_FAILURE);
+        }
+        log_out("Shared memory ring at /dev/shm/{}", shm_name);
+    }
+
+    // binary per-frame diagnostics
+    frame_recorder.set_fields(frame_record_fields);
+    if (frame_record_port > 0) {
+        std::string frame_record_address;
+        std::format_to(std::back_inserter(frame_record_address), "tcp://*:{}", frame_record_port);
+        frame_recorder.open_socket(frame_record_address);
+        log_out("Frame records on {}", frame_record_address);
+    }
+    if (!frame_record_file.empty()) {
+        if (!frame_recorder.open_file(frame_record_file)) {
+            log_err("Failed to open frame record file '{}'", frame_record_file);
+            std::exit(EXIT_FAILURE);
+        }
+        log_out("Frame records to '{}'", frame_record_file);
+    }
 
     // initial load rc4 transponder database
     rc4_registry = std::make_unique<RC4FileBasedRegistry>(storage_dir);
     rc4_registry->resync();
-}
 
-uint64_t reporting_timestamp(uint64_t timestamp_us, uint64_t steady_now, uint64_t sysclk_now) {
-    if (mode_sysclk) {
-        return (sysclk_now - (steady_now - timestamp_us))/1000ul;
-    } else {
-        return timestamp_us/1000ul;
+    // the decoder itself
+    for (size_t loop = 0; loop < loop_inputs.size(); loop++) {
+        report_sinks.push_back(std::make_unique<ReportSink>(loop));
+        pipelines.push_back(std::make_unique<DecoderPipeline>(*report_sinks.back(), *rc4_registry, PipelineClock{
+            .virtual_time = mode_offline,
+            .epoch = startup_ts
+        }, loop_inputs[loop], samples_per_symbol));
+        if (loop_inputs[loop] > 1) {
+            log_out("Loop {}: antenna diversity over {} inputs", loop, loop_inputs[loop]);
+        }
     }
 }
 
 void report_detections() {
-    const uint64_t now_sysclk = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
-    const uint64_t now_ts = duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count() - startup_ts;
-    const uint64_t status_ts = reporting_timestamp(now_ts, now_ts, now_sysclk);
-
-    // report status once a second
-    if (rx_stats.reporting_due(now_ts)) {
-        const std::string report = std::format("S {} {}",
-            status_ts,
-            rx_stats.to_string()
-        );
-        rx_stats.reset(now_ts);
-
-        std::cout << report << std::endl;
-        publisher->send(zmq::buffer(report), zmq::send_flags::none);
-    }
-    
-    std::vector<TimeSync> timesyncs = passing_detector.identify_timesyncs(500000l);
-    for (const auto& time_sync : timesyncs) {
-        const std::string report = std::format("T {} {} {} {}",
-            reporting_timestamp(time_sync.timestamp, now_ts, now_sysclk),
-            transponder_system_name(time_sync.transponder_type), // always openstint
-            time_sync.transponder_id,
-            time_sync.transponder_timestamp
-        );
-
-        std::cout << report << std::endl;
-        publisher->send(zmq::buffer(report), zmq::send_flags::none);
+    // pick up clients (un)subscribing since the last cycle, serve catch-up requests
+    publisher->poll_subscriptions();
+    if (frame_recorder.is_enabled()) {
+        std::lock_guard<std::mutex> lock(frame_recorder_mutex);
+        frame_recorder.poll_subscriptions();
     }
+    journal_server->poll();
 
-    std::vector<Passing> passings = passing_detector.identify_passings(now_ts > 250000ul ? (now_ts-250000ul) : 0ul);
-    for (const auto& passing : passings) {
-        const std::string report = std::format("P {} {} {} {:.2f} {} {}",
-            reporting_timestamp(passing.timestamp, now_ts, now_sysclk),
-            transponder_system_name(passing.transponder_type),
-            passing.transponder_id,
-            passing.rssi,
-            passing.hits,
-            passing.duration
-        );
-
-        std::cout << report << std::endl;
-        publisher->send(zmq::buffer(report), zmq::send_flags::none);
+    for (auto& pipeline : pipelines) {
+        pipeline->report();
     }
 
-    auto trainer_result = rc4_trainer.evaluate(now_ts);
-    switch (trainer_result) {
-        case RC4Trainer::EvaluationResult::START: {
-            const auto report = std::format("L {} START {:.1f}", status_ts, rc4_trainer.last_rssi());
-            std::cout << report << std::endl;
-            publisher->send(zmq::buffer(report), zmq::send_flags::none);
-        }
-        break;
-        case RC4Trainer::EvaluationResult::INTERRUPED: {
-            const auto report = std::format("L {} INTERRUPTED", status_ts);
-            std::cout << report << std::endl;
-            publisher->send(zmq::buffer(report), zmq::send_flags::none);
-        }
-        break;
-        case RC4Trainer::EvaluationResult::DONE: {
-            uint32_t transponder_id = rc4_trainer.preferred_transponder_id();
-            auto payloads = rc4_trainer.registry_payloads();
-            auto [tsmin, tsmax] = rc4_trainer.buffer_timerange();
-            auto detected_transponders = passing_detector.passings_between(TransponderSystem::AMB, tsmin, tsmax);
-            if (transponder_id == 0 && detected_transponders.size() == 1) {
-                transponder_id = detected_transponders.front();
-            }
-            transponder_id = rc4_registry->store(transponder_id, payloads);
-            const auto report = std::format("L {} DONE {} {}", status_ts, transponder_id, payloads.size());
-            std::cout << report << std::endl;
-            publisher->send(zmq::buffer(report), zmq::send_flags::none);
-        }
-        break;
-        case RC4Trainer::EvaluationResult::RESET: {
-            const auto report = std::format("L {} RESET", status_ts);
-            std::cout << report << std::endl;
-            publisher->send(zmq::buffer(report), zmq::send_flags::none);
-        }
-        break;
-        case RC4Trainer::EvaluationResult::NO_ACTION:
-        // no action
-        break;
+    // host clock drift against the time-sync references
+    const uint64_t now_ts = pipelines.front()->now();
+    DriftStatus drift;
+    if (now_ts >= drift_reported_ts + DRIFT_REPORTING_PERIOD_US && drift_estimator.status(&drift)) {
+        drift_reported_ts = now_ts;
+        const uint64_t timestamp = reporting_timestamp(now_ts, *pipelines.front());
+        publish('C', timestamp, [&] {
+            return std::format("C {} {:.3f} {:.2e} {:.2e} {:.2e} {}",
+                timestamp,
+                drift.ppm,
+                drift.adev[0],
+                drift.adev[1],
+                drift.adev[2],
+                drift.references
+            );
+        });
     }
 
-    // re-sync rc4 transponder database
-    rc4_registry->resync();
-}
\ No newline at end of file
+    // re-sync rc4 transponder database; offline runs keep the one loaded at
+    // startup, so their output does not depend on when the directory changed
+    if (!mode_offline) {
+        rc4_registry->resync();
+    }
+}
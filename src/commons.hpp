@@ -4,12 +4,23 @@
 #include <cstddef>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "frame.hpp"
 
 #define DEFAULT_ZEROMQ_PORT 5556
+#define DEFAULT_JOURNAL_PORT 5557
 
-void detect_frames(const std::complex<int8_t>* samples, std::size_t sample_count);
+// samples of an input of a loop; loops and inputs run in parallel, one thread each
+void detect_frames(const std::complex<int8_t>* samples, std::size_t sample_count, std::size_t loop = 0, std::size_t input = 0);
 bool parse_common_arguments(int& i, const int argc, const std::string& arg, char** argv);
-void init_commons();
+// a pipeline per loop, with the given number of inputs (antenna diversity if more),
+// all sampled at <samples_per_symbol>
+void init_commons(const std::vector<std::size_t>& loop_inputs = {1}, int samples_per_symbol = SAMPLES_PER_SYMBOL);
+// pin the calling DSP thread (0, 1, ...) to a core of its own (Linux only)
+void pin_thread_to_core(std::size_t thread_index);
 void report_detections();
+// offline replay (-x): timestamps are derived from the sample counter
+bool offline_mode();
+// advance the sample counter without processing, ie. to let pending passings time out
+void skip_samples(std::size_t sample_count);
@@ -14,6 +14,20 @@ void RxStatistics::register_frame(bool processed) {
     if (processed) { frames_processed++; }
 }
 
+void RxStatistics::register_abort() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    frames_received++;
+    frames_aborted++;
+}
+
+void RxStatistics::register_drop(uint64_t sample_count) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    drops++;
+    lost_samples += sample_count;
+}
+
 void RxStatistics::save_channel_characteristics(std::complex<float> _dc_offset, float _noise_power) {
     std::lock_guard<std::mutex> lock(mutex);
 
@@ -26,10 +40,12 @@ void RxStatistics::reset(uint64_t current_timestamp) {
 
     frames_received = 0;
     frames_processed = 0;
+    frames_aborted = 0;
+    drops = 0;
     last_reset_timestamp = current_timestamp;
 }
 
-std::string RxStatistics::to_string() {
+RxStatus RxStatistics::status() {
     std::lock_guard<std::mutex> lock(mutex);
 
     // there is a minor trickery here: noise power is calculated from sample variance (sigma-squared),
@@ -38,14 +54,15 @@ std::string RxStatistics::to_string() {
     //      = 10*log(Psig) - 10*log(Pmax)
     //      = 10*log(Psig) - 20*log(Vmax)
     float noise_floor = 10.0f * std::log10(noise_power) - 20.0 * std::log10(ADC_FULL_SCALE);
-    
-    std::string temp;
-    std::format_to(
-        std::back_inserter(temp), "{:.2f} {:.2f} {} {}",
-        noise_floor, 
-        std::abs(dc_offset), 
+
+    RxStatus status = {
+        noise_floor,
+        std::abs(dc_offset),
         frames_received,
         frames_processed
-    );
-    return temp;
-}
\ No newline at end of file
+    };
+    status.frames_aborted = frames_aborted;
+    status.drops = drops;
+    status.lost_samples = lost_samples;
+    return status;
+}
@@ -11,9 +11,25 @@
 
 #include "frame.hpp"
 
+struct RxStatus {
+    float noise_floor; // dBFS
+    float dc_offset;   // magnitude
+    uint32_t frames_received;
+    uint32_t frames_processed;
+    uint32_t frames_aborted = 0; // of frames_received: abandoned early as hopeless
+    float clock_ppm = 0.0f;    // sample clock rate error against the host clock
+    float clock_jitter = 0.0f; // rms deviation of the buffer times from the clock model, us
+    uint32_t drops = 0;        // sample losses in the reporting period
+    uint64_t lost_samples = 0; // since startup (estimate)
+    float preamble_thresholds[3] = {0.0f, 0.0f, 0.0f}; // of the preamble search, by TransponderProtocol
+};
+
 class RxStatistics {
     uint32_t frames_received = 0;
     uint32_t frames_processed = 0;
+    uint32_t frames_aborted = 0;
+    uint32_t drops = 0;
+    uint64_t lost_samples = 0;
     std::complex<float> dc_offset = {0, 0};
     float noise_power = 0;
     uint64_t last_reset_timestamp = 0;
@@ -22,10 +38,13 @@ class RxStatistics {
 
 public:
     void register_frame(bool processed);
+    // a frame abandoned before it was complete (counts as received)
+    void register_abort();
+    void register_drop(uint64_t sample_count);
     void save_channel_characteristics(std::complex<float> dc_offset, float noise_power);
 
     void reset(uint64_t current_timestamp);
     bool reporting_due(uint64_t current_timestamp);
-    std::string to_string();
+    RxStatus status();
 };
 
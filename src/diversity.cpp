@@ -0,0 +1,91 @@
+#include "diversity.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+
+DiversityCombiner::DiversityCombiner(size_t input_count, uint32_t _sample_rate)
+    : sample_rate(_sample_rate), match_window(static_cast<int64_t>(DIVERSITY_MATCH_US) * _sample_rate / 1000000), inputs(input_count) {}
+
+uint64_t DiversityCombiner::map_timecode(size_t input, uint64_t timecode) const {
+    if (input == 0 || !inputs[0].aligned) {
+        return timecode;
+    }
+    const double offset = inputs[input].clock - inputs[0].clock + inputs[input].skew;
+    const int64_t mapped = static_cast<int64_t>(timecode) + std::llround(offset);
+    return mapped > 0 ? static_cast<uint64_t>(mapped) : 0;
+}
+
+void DiversityCombiner::align(size_t input, uint64_t timecode, uint64_t timestamp) {
+    // buffers arrive with some jitter; averaging keeps up with the drift
+    // between the radios' crystals, but not with the jitter
+    const double clock = static_cast<double>(timestamp) * sample_rate / 1e6 - static_cast<double>(timecode);
+    Input& in = inputs[input];
+    if (!in.aligned) {
+        in.clock = clock;
+        in.aligned = true;
+    } else {
+        in.clock += (clock - in.clock) / DIVERSITY_CLOCK_AVERAGING;
+    }
+}
+
+void DiversityCombiner::push(size_t input, DecodedFrame frame) {
+    const uint32_t input_bit = 1u << input;
+    frame.timecode = map_timecode(input, frame.timecode);
+
+    // the same frame, received on an other input
+    PendingFrame* match = nullptr;
+    int64_t match_distance = match_window + 1;
+    for (auto it = pending.rbegin(); it != pending.rend(); ++it) {
+        const int64_t distance = static_cast<int64_t>(it->frame.timecode) - static_cast<int64_t>(frame.timecode);
+        if (distance < -match_window) {
+            break;
+        }
+        if ((it->inputs & input_bit) || it->frame.protocol != frame.protocol || it->frame.message != frame.message) {
+            continue;
+        }
+        if (std::abs(distance) < match_distance) {
+            match = &*it;
+            match_distance = std::abs(distance);
+        }
+    }
+
+    if (match) {
+        match->frame.rssi = std::max(match->frame.rssi, frame.rssi);
+        match->inputs |= input_bit;
+        // refine the mapping on the exact timecodes of the two copies
+        if (match->reference == 0) {
+            inputs[input].skew += static_cast<double>(static_cast<int64_t>(match->frame.timecode) - static_cast<int64_t>(frame.timecode)) / DIVERSITY_SKEW_AVERAGING;
+        } else if (input == 0) {
+            inputs[match->reference].skew += static_cast<double>(static_cast<int64_t>(frame.timecode) - static_cast<int64_t>(match->frame.timecode)) / DIVERSITY_SKEW_AVERAGING;
+            // timecodes of input 0 are the reference; the frame may move a few samples
+            match->frame.timecode = frame.timecode;
+            match->frame.timestamp = frame.timestamp;
+            match->reference = 0;
+            std::sort(pending.begin(), pending.end(), [](const PendingFrame& a, const PendingFrame& b) {
+                return a.frame.timecode < b.frame.timecode;
+            });
+        }
+        return;
+    }
+
+    if (frame.timecode <= released_timecode) {
+        return; // too late, the frames around it are already out
+    }
+    auto position = pending.end();
+    while (position != pending.begin() && std::prev(position)->frame.timecode > frame.timecode) {
+        --position;
+    }
+    pending.insert(position, { frame, input_bit, input });
+}
+
+std::vector<DecodedFrame> DiversityCombiner::release(uint64_t deadline) {
+    std::vector<DecodedFrame> frames;
+    while (!pending.empty() && pending.front().frame.timestamp <= deadline) {
+        released_timecode = pending.front().frame.timecode;
+        frames.push_back(pending.front().frame);
+        pending.pop_front();
+    }
+    return frames;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "receiver.hpp"
+
+#define DIVERSITY_MATCH_US 500      // same frame on two inputs; transponders repeat every ~1.4 ms
+#define DIVERSITY_HOLD_US 50000     // wait for the other inputs' buffers before releasing a frame
+#define DIVERSITY_CLOCK_AVERAGING 64 // buffers
+#define DIVERSITY_SKEW_AVERAGING 8   // matched frames
+
+// Antenna diversity: receivers listening to the same loop (two radios, or two
+// pickups) are merged into a single stream of frames.
+//
+// Every input has a sample counter of its own, timecodes are mapped to the one
+// of input 0: coarsely from the arrival times of the buffers, then refined on
+// the frames both inputs received. A frame received on more inputs (same
+// message, timecodes within DIVERSITY_MATCH_US) is kept once, with the best
+// RSSI, so passings are computed on the upper envelope of the per-input RSSI
+// traces. Not thread-safe.
+class DiversityCombiner {
+    struct Input {
+        bool aligned = false;
+        double clock = 0.0; // steady clock at the input's timecode 0, in samples
+        double skew = 0.0;  // offset to input 0 the clocks do not show (USB latency), in samples
+    };
+    struct PendingFrame {
+        DecodedFrame frame;
+        uint32_t inputs;    // bitmask of the inputs which received it
+        size_t reference;   // input the timecode and timestamp come from
+    };
+
+    const uint32_t sample_rate;
+    const int64_t match_window; // DIVERSITY_MATCH_US, in samples
+    std::vector<Input> inputs;
+    std::deque<PendingFrame> pending; // by timecode
+    uint64_t released_timecode = 0;
+
+    uint64_t map_timecode(size_t input, uint64_t timecode) const;
+
+public:
+    DiversityCombiner(size_t input_count, uint32_t sample_rate);
+
+    // a buffer of <input> starting at <timecode> arrived at <timestamp> (us)
+    void align(size_t input, uint64_t timecode, uint64_t timestamp);
+    // a frame decoded on <input>
+    void push(size_t input, DecodedFrame frame);
+    // the de-duplicated frames up to <deadline> (us), in timecode order
+    std::vector<DecodedFrame> release(uint64_t deadline);
+};
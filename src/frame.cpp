@@ -4,9 +4,9 @@
 #include <bit>
 #include <complex>
 #include <cstring>
-#include <iterator>
 #include <algorithm>
-#include <iostream>
+#include <array>
+#include <format>
 
 #include "complex_cast.hpp"
 
@@ -14,13 +14,34 @@
 #define PREAMBLE_MAX_BIT_ERRORS 2
 #define STATS_UPDATE_THRESHOLD (1<<12)
 
+// early abort of hopeless frames (see SymbolReader::is_frame_viable())
+//
+// The EQ scales the frame to the unit constellation. Noise of the same power
+// averages an EVM of ~0.85, a frame at 3 dB SNR (the limit of reliable
+// reception) ~0.62, at 6 dB ~0.44. A transponder gone mid-frame leaves noise
+// far below the level the EQ was trained for: the symbols shrink towards 0,
+// and so does their soft-bit confidence (~|re|). Over 24 symbols (the preamble
+// and 8 more), the mean EVM of a 3 dB frame exceeds 0.8 in ~0.4% of the frames
+// (in ~1.4% over 16 symbols); frames at 6 dB or better practically never.
+#define FRAME_ABORT_MIN_SYMBOLS 24     // symbols read before the noise gate applies
+#define FRAME_ABORT_EVM 0.8f           // mean EVM: between a 3 dB frame and noise
+#define FRAME_ABORT_CONFIDENCE 0.2f    // mean soft-bit confidence (0..1): signal 10+ dB below the trained level
+
 #define PREAMBLE_THRESHOLD 0.78f
 #define PREAMBLE_15BIT_PENALTY (15.0f/16.0f)
 
 // preamble matching
-static inline const Preamble<uint16_t> p_openstint(transponder_props(TransponderProtocol::OpenStint).dpsk_preamble, PREAMBLE_THRESHOLD*PREAMBLE_15BIT_PENALTY);
-static inline const Preamble<uint16_t> p_rc3(transponder_props(TransponderProtocol::RC3).dpsk_preamble, PREAMBLE_THRESHOLD*PREAMBLE_15BIT_PENALTY);
-static inline const Preamble<uint16_t> p_rc4(transponder_props(TransponderProtocol::RC4).dpsk_preamble, PREAMBLE_THRESHOLD);
+static inline const Preamble<uint16_t> p_openstint(transponder_props(TransponderProtocol::OpenStint).dpsk_preamble);
+static inline const Preamble<uint16_t> p_rc3(transponder_props(TransponderProtocol::RC3).dpsk_preamble);
+static inline const Preamble<uint16_t> p_rc4(transponder_props(TransponderProtocol::RC4).dpsk_preamble);
+
+// the preambles of TRANSPONDER_PROPERTIES, upsampled to the sample rate
+template<int SPS>
+static constexpr std::array<std::array<float, PREAMBLE_LENGTH * SPS>, 3> preambles_up = {
+    preamble_upsampled<SPS>(transponder_props(TransponderProtocol::OpenStint).preamble),
+    preamble_upsampled<SPS>(transponder_props(TransponderProtocol::RC3).preamble),
+    preamble_upsampled<SPS>(transponder_props(TransponderProtocol::RC4).preamble)
+};
 
 
 Frame::Frame() {
@@ -40,7 +61,7 @@ Frame::Frame(TransponderProtocol _ttype, float _pm, uint64_t _ts, uint64_t _tc)
     preamble_size = 16;
 }
 
-uint32_t concat_bits32(uint8_t *soft_bits) {
+uint32_t concat_bits32(const uint8_t *soft_bits) {
     uint32_t v = 0;
     for (int i=0; i<32; i++) {
         v <<= 1;
@@ -67,9 +88,10 @@ int preamble_pos(uint32_t sof, uint16_t preamble) {
     return -1;
 }
 
-const uint8_t* Frame::bits() {
+int Frame::find_preamble(bool *inverted) const {
+    *inverted = false;
     if (softbits.size() < 32) {
-        return nullptr;
+        return -1;
     }
 
     // start-of-frame 32 bits contain the preamble
@@ -78,15 +100,23 @@ const uint8_t* Frame::bits() {
     if (pos < 0) {
         // try with bits inverted:
         pos = preamble_pos(~sof, transponder_props(transponder_protocol).preamble);
-        if (pos < 0) { // preamble not found
-            return nullptr;
-        } else { // preamble found, but BPSK does not know the correct phase
-            std::transform(
-                softbits.begin(), softbits.end(),
-                softbits.begin(),
-                [](uint8_t x) { return 0xff-x; }
-            );
-        }
+        *inverted = (pos >= 0);
+    }
+    return pos;
+}
+
+const uint8_t* Frame::bits() {
+    bool inverted;
+    int pos = find_preamble(&inverted);
+    if (pos < 0) { // preamble not found
+        return nullptr;
+    }
+    if (inverted) { // preamble found, but BPSK does not know the correct phase
+        std::transform(
+            softbits.begin(), softbits.end(),
+            softbits.begin(),
+            [](uint8_t x) { return 0xff-x; }
+        );
     }
     if (softbits.size() < pos + preamble_size + payload_size) {
         // could not read enough bits (this should be an exception btw...)
@@ -101,42 +131,58 @@ float Frame::rssi() const {
 }
 
 float Frame::evm() const {
-    return evm_sum / (payload_size + preamble_size + SymbolReader::fseq_syms);
+    return evm_sum / (payload_size + preamble_size + SymbolWindow::fseq_syms);
 }
 
 float Frame::symbol_magnitude() const {
     return 1.0f / symbol_scale;
 }
 
-std::ostream& operator <<(std::ostream& os, const Frame& f) {
-    std::stringstream ssym;
-    std::transform(f.symbols.begin(), f.symbols.end(),
-        std::ostream_iterator<std::string>(ssym, ", "),
-        [](const std::complex<float>& c) {
-            std::stringstream ss;
-            float re = c.real(), im = c.imag();
-            if (re != 0 || im == 0) ss << re;
-            if (im != 0) {
-                if (im >= 0 && re != 0) ss << "+";
-                ss << im << "j";
+std::format_context::iterator std::formatter<Frame>::format(const Frame& f, std::format_context& ctx) const {
+    // {:g} matches the iostream default float notation of earlier versions
+    auto out = std::format_to(ctx.out(), "{} TS:{} TC:{} M:{:g} RSSI:{:g} EVM:{:g} FREQ:{:g} MAG:{:g} SYMBOLS:[",
+        transponder_props(f.transponder_protocol).prefix,
+        f.timestamp / 1000,
+        f.timecode,
+        f.preamble_metric,
+        f.rssi(),
+        f.evm(),
+        f.phase_per_symbol / (2.0f * 3.14) * 1250000.0f,
+        f.symbol_magnitude());
+    for (const auto& c : f.symbols) {
+        const float re = c.real(), im = c.imag();
+        if (re != 0 || im == 0) {
+            out = std::format_to(out, "{:g}", re);
+        }
+        if (im != 0) {
+            if (im >= 0 && re != 0) {
+                out = std::format_to(out, "+");
             }
-            return ss.str();
-        });
-    std::stringstream sbits;
-    std::copy(f.softbits.begin(), f.softbits.end(), std::ostream_iterator<int>(sbits, ", "));
-    return os << transponder_props(f.transponder_protocol).prefix
-              << " TS:" << (f.timestamp/1000)
-              << " TC:" << f.timecode
-              << " M:" << f.preamble_metric
-              << " RSSI:" << f.rssi()
-              << " EVM:" << f.evm()
-              << " FREQ:" << (f.phase_per_symbol / (2.0f * 3.14) * 1250000.0f)
-              << " MAG:" << f.symbol_magnitude()
-              << " SYMBOLS:[" << ssym.str() << "]"
-              << " SOFTBITS:[" << sbits.str() << "]";
+            out = std::format_to(out, "{:g}j", im);
+        }
+        out = std::format_to(out, ", ");
+    }
+    out = std::format_to(out, "] SOFTBITS:[");
+    for (const uint8_t b : f.softbits) {
+        out = std::format_to(out, "{}, ", b);
+    }
+    return std::format_to(out, "]");
+}
+
+float default_preamble_threshold(TransponderProtocol protocol) {
+    // OpenStint and RC3 are matched on 15 bits (see process_baseband())
+    return (protocol == TransponderProtocol::RC4) ? PREAMBLE_THRESHOLD : PREAMBLE_THRESHOLD*PREAMBLE_15BIT_PENALTY;
+}
+
+template<int SPS>
+FrameDetector<SPS>::FrameDetector() {
+    for (int i=0; i<3; i++) {
+        thresholds[i] = default_preamble_threshold(static_cast<TransponderProtocol>(i));
+    }
 }
 
-std::optional<DetectionResult> FrameDetector::process_baseband(const std::complex<int8_t> *samples) {
+template<int SPS>
+std::optional<DetectionResult> FrameDetector<SPS>::process_baseband(const std::complex<int8_t> *samples) {
     // Preamble detection works on differential-encoded signals;
     // This is tolerant to larger frequency offsets.
     // 
@@ -156,32 +202,42 @@ std::optional<DetectionResult> FrameDetector::process_baseband(const std::comple
     // For small Δω, e^{jΔω}~=1; the conjugate product cancels the (unknown) carrier phase
     // and removes the per-symbol rotation from any frequency offset, leaving a practically
     // real-valued ±|A|^2 sequence, that is the differentially-encoded preamble bit pattern.
-    std::complex<int32_t> r[samples_per_symbol];
-    for (int i=0; i<samples_per_symbol; i++) {
-        r[i] = complex_cast<int32_t>(samples[i]) - offset;
+    //
+    // Decimation: each phase is the mean of <decimation> consecutive samples
+    // (a boxcar, the matched filter of the rectangular chips over its span),
+    // which keeps the amplitude and drops the out-of-band noise.
+    std::complex<int32_t> r[search_phases];
+    for (int i=0; i<search_phases; i++) {
+        std::complex<int32_t> sum = {0, 0};
+        for (int k=0; k<decimation; k++) {
+            sum += complex_cast<int32_t>(samples[i*decimation + k]);
+        }
+        r[i] = sum / decimation - offset;
     }
-    for (int i=0; i<samples_per_symbol; i++) {
+    for (int i=0; i<search_phases; i++) {
         std::complex<int32_t> z = r[i] * std::conj(last_samples[i]);
         int32_t zr = std::clamp(std::real(z), (int32_t)INT16_MIN, (int32_t)INT16_MAX);
         buffers[i].push(static_cast<int16_t>(zr), zr*zr);
     }
-    for (int i=0; i<samples_per_symbol; i++) {
+    for (int i=0; i<search_phases; i++) {
         last_samples[i] = r[i];
     }
 
     // select the best-looking buffer to compute preamble-match
-    uint32_t wes[samples_per_symbol];
-    for (int i=0; i<samples_per_symbol; i++) { 
+    uint32_t wes[search_phases];
+    for (int i=0; i<search_phases; i++) { 
         wes[i] = buffers[i].window_energy;
     }
-    int idx = std::distance(wes, std::max_element(wes, wes+samples_per_symbol)); // ~maxarg
+    int idx = std::distance(wes, std::max_element(wes, wes+search_phases)); // ~maxarg
 
-    // update statistics (sample first element)
+    // update statistics (sample first element, at the full rate: the noise
+    // level does not depend on the decimation)
+    const std::complex<int32_t> r0 = complex_cast<int32_t>(samples[0]) - offset;
     s1 += samples[0];
-    s2 += std::norm(r[0]);
+    s2 += std::norm(r0);
     n++;
     
-    if (buffers[idx].match_preamble(p_rc4)) {       
+    if (buffers[idx].match_preamble(p_rc4, thresholds[static_cast<int>(TransponderProtocol::RC4)])) {       
         return {{ TransponderProtocol::RC4, buffers[idx].calc_metric(p_rc4) }};
     }
 
@@ -193,19 +249,20 @@ std::optional<DetectionResult> FrameDetector::process_baseband(const std::comple
     // v1 transponder use the correct init sequence (-1 -1 -1 -1)
     // v2-beta used incorrect; to keep those tranponders alive, match on 15 bits only
     // new transpoders are fixed, this affects ~5 team/people
-    if (buffers[idx].match_preamble(p_openstint)) {
+    if (buffers[idx].match_preamble(p_openstint, thresholds[static_cast<int>(TransponderProtocol::OpenStint)])) {
         return {{ TransponderProtocol::OpenStint, buffers[idx].calc_metric(p_openstint) }};
     }
 
     // - AmbRC/RCHG/MRT use 0xF916 dpsk preamble
     // - RC4Hybrid use 0x7916
-    if (buffers[idx].match_preamble(p_rc3)) {
+    if (buffers[idx].match_preamble(p_rc3, thresholds[static_cast<int>(TransponderProtocol::RC3)])) {
         return {{ TransponderProtocol::RC3, buffers[idx].calc_metric(p_rc3) }};
     }
     return std::nullopt;
 }
 
-void FrameDetector::update_statistics() {
+template<int SPS>
+void FrameDetector<SPS>::update_statistics() {
     if (n > STATS_UPDATE_THRESHOLD) {
         offset = complex_cast<int8_t>(s1 / n);
         offset_hires = complex_cast<float>(s1) / static_cast<float>(n);
@@ -214,15 +271,17 @@ void FrameDetector::update_statistics() {
     }
 }
 
-void FrameDetector::reset_statistics_counters() {
+template<int SPS>
+void FrameDetector<SPS>::reset_statistics_counters() {
     s1 = std::complex<int32_t>(0, 0);
     s2 = 0;
     n = 0;
 }
 
-float FrameDetector::symbol_energy() const {
+template<int SPS>
+float FrameDetector<SPS>::symbol_energy() const {
     uint32_t max_energy = buffers[0].window_energy;
-    for (int i=1; i<samples_per_symbol; i++) {
+    for (int i=1; i<search_phases; i++) {
         if (buffers[i].window_energy > max_energy) {
             max_energy = buffers[i].window_energy;
         }
@@ -231,22 +290,26 @@ float FrameDetector::symbol_energy() const {
     return static_cast<float>(max_energy) / 16.0f;
 }
 
-float FrameDetector::noise_energy() const {
+template<int SPS>
+float FrameDetector<SPS>::noise_energy() const {
     return variance;
 }
 
-std::complex<float> FrameDetector::dc_offset() const {
+template<int SPS>
+std::complex<float> FrameDetector<SPS>::dc_offset() const {
     return offset_hires;
 }
 
-SymbolReader::SymbolReader() {
+template<int SPS>
+SymbolReader<SPS>::SymbolReader() {
     std::complex<float> h[fseq_syms * samples_per_symbol] = {0};
     sym_eq = eqlms_cccf_create(h, fseq_syms * samples_per_symbol);
     // sym_eq = eqlms_cccf_create_lowpass(fseq_syms * samples_per_symbol, 0.5f);
     bpsk_modem = modemcf_create(LIQUID_MODEM_BPSK);
 }
 
-SymbolReader::~SymbolReader() {
+template<int SPS>
+SymbolReader<SPS>::~SymbolReader() {
     eqlms_cccf_destroy(sym_eq);
     modemcf_destroy(bpsk_modem);
 }
@@ -260,7 +323,8 @@ float window_energy(const std::complex<float> x[]) {
     return acc;
 }
 
-void SymbolReader::train_preamble(Frame *frame, const std::complex<int8_t> *src, int end, std::complex<float> dc_offset) {
+template<int SPS>
+void SymbolReader<SPS>::train_preamble(Frame *frame, const std::complex<int8_t> *src, int end, std::complex<float> dc_offset) {
     // load from SDR buffer to an internal one
     load_preamble_buffer(src, end, dc_offset);
 
@@ -288,7 +352,8 @@ void SymbolReader::train_preamble(Frame *frame, const std::complex<int8_t> *src,
     eqlms_cccf_set_bw(sym_eq, eq_mu_track);
 }
 
-void SymbolReader::load_preamble_buffer(const std::complex<int8_t> *src, int end, std::complex<float> dc_offset) {
+template<int SPS>
+void SymbolReader<SPS>::load_preamble_buffer(const std::complex<int8_t> *src, int end, std::complex<float> dc_offset) {
     // read symbols to resampled buffer
     for (int i=0; i<preamble_buffer_size; i++) {
         int sample_idx = end - preamble_buffer_size + i;
@@ -302,10 +367,11 @@ void SymbolReader::load_preamble_buffer(const std::complex<int8_t> *src, int end
     }
 }
 
-std::pair<float, float> SymbolReader::estimate_phase_freq(Frame *frame, int shift) {
+template<int SPS>
+std::pair<float, float> SymbolReader<SPS>::estimate_phase_freq(Frame *frame, int shift) {
     const int n = preamble_length * samples_per_symbol;
     const int start = fseq_halflen * samples_per_symbol;
-    const auto &preamble_up = transponder_props(frame->transponder_protocol).preamble_up;
+    const auto &preamble_up = preambles_up<SPS>[static_cast<int>(frame->transponder_protocol)];
 
     // y = sample-spaced preamble with the BPSK (±1) modulation stripped off
     // multiply by known preamble rotates symbols to a single point (per sample/phase)
@@ -332,7 +398,8 @@ std::pair<float, float> SymbolReader::estimate_phase_freq(Frame *frame, int shif
     return {ph0, dphi};
 }
 
-void SymbolReader::train_fseq(Frame *frame, float mu) {
+template<int SPS>
+void SymbolReader<SPS>::train_fseq(Frame *frame, float mu) {
     const auto &preamble_syms = transponder_props(frame->transponder_protocol).preamble_syms;
 
     // set the LMS learning rate for this epoch
@@ -361,7 +428,8 @@ void SymbolReader::train_fseq(Frame *frame, float mu) {
     }
 }
 
-void SymbolReader::read_preamble(Frame *frame, const std::complex<int8_t> *src, int end, std::complex<float> dc_offset) {
+template<int SPS>
+void SymbolReader<SPS>::read_preamble(Frame *frame, const std::complex<int8_t> *src, int end, std::complex<float> dc_offset) {
     // read preamble as regular data
     const int sample_count = preamble_symbol_count * samples_per_symbol;
     for (int i=0; i<preamble_symbol_count; i++) {
@@ -376,7 +444,8 @@ void SymbolReader::read_preamble(Frame *frame, const std::complex<int8_t> *src,
     }
 }
 
-void SymbolReader::read_symbol(Frame *frame, const std::complex<int8_t> *src, std::complex<float> dc_offset) {
+template<int SPS>
+void SymbolReader<SPS>::read_symbol(Frame *frame, const std::complex<int8_t> *src, std::complex<float> dc_offset) {
     // scale & derotate this symbol's samples (same normalization the EQ was
     // trained with): the carrier phase advances by phase_per_symbol/samples_per_symbol
     // for every sample. Then feed them to the fractionally-spaced equalizer.
@@ -401,6 +470,7 @@ void SymbolReader::read_symbol(Frame *frame, const std::complex<int8_t> *src, st
     frame->softbits.push_back(soft_bit);
     frame->symbols.push_back(symbol);
     frame->evm_sum += modemcf_get_demodulator_evm(bpsk_modem);
+    frame->confidence_sum += std::abs(2 * static_cast<int>(soft_bit) - 255);
 
     // decision-directed (blind) EQ update toward the demodulated symbol
     std::complex<float> d_prime;
@@ -408,7 +478,8 @@ void SymbolReader::read_symbol(Frame *frame, const std::complex<int8_t> *src, st
     eqlms_cccf_step(sym_eq, d_prime, symbol);
 }
 
-void SymbolReader::update_reserve_buffer(const std::complex<int8_t> *src, int end) {
+template<int SPS>
+void SymbolReader<SPS>::update_reserve_buffer(const std::complex<int8_t> *src, int end) {
     std::memcpy(
         reserve_buffer,
         src + end - reserve_buffer_size,
@@ -416,15 +487,54 @@ void SymbolReader::update_reserve_buffer(const std::complex<int8_t> *src, int en
     );
 }
 
-bool SymbolReader::is_frame_complete(const Frame *f) {
+template<int SPS>
+bool SymbolReader<SPS>::is_frame_complete(const Frame *f) {
     // we read the preamble + -1th bit to initialize differential-BPSK demodulation
     // payload, obviously
     // the symbol-sync's filters has their own delay
     return f->softbits.size() > (f->preamble_size + f->payload_size + fseq_syms);
 }
 
-void SymbolReader::costas_tune_correction(Frame *frame, std::complex<float> symbol) {
+template<int SPS>
+bool SymbolReader<SPS>::is_frame_viable(const Frame *f, FrameOutcome *outcome) const {
+    // Frame::bits() looks for the preamble in the first 32 bits only; once
+    // they are in, the rest of the frame can not make up for a missing one
+    const size_t symbol_count = f->softbits.size();
+    if (symbol_count == 32) {
+        bool inverted;
+        if (f->find_preamble(&inverted) < 0) {
+            *outcome = FrameOutcome::NO_SYNC;
+            return false;
+        }
+    }
+
+    // running EVM and soft-bit confidence: noise the preamble matched by chance,
+    // or a frame lost mid-way (collision, timing slip). Before 32 bits, the
+    // preamble is not confirmed: the trigger was noise, a false trigger just
+    // like a missing preamble (NO_SYNC). After it, the frame was real.
+    if (symbol_count < FRAME_ABORT_MIN_SYMBOLS) {
+        return true;
+    }
+    const float evm = f->evm_sum / symbol_count;
+    const float confidence = f->confidence_sum / (255.0f * symbol_count);
+    if (evm > FRAME_ABORT_EVM || confidence < FRAME_ABORT_CONFIDENCE) {
+        *outcome = (symbol_count < 32) ? FrameOutcome::NO_SYNC : FrameOutcome::REJECTED;
+        return false;
+    }
+    return true;
+}
+
+template<int SPS>
+void SymbolReader<SPS>::costas_tune_correction(Frame *frame, std::complex<float> symbol) {
     float error = std::arg(symbol*symbol) / 2.0f; // phase; slower than real*imag, but much better
     frame->phase_per_symbol += costas_i * error;
     frame->phase += frame->phase_per_symbol + costas_p * error;
 }
+
+// the variants binaries can pick from (see supported_samples_per_symbol())
+template class FrameDetector<2>;
+template class FrameDetector<4>;
+template class FrameDetector<8>;
+template class SymbolReader<2>;
+template class SymbolReader<4>;
+template class SymbolReader<8>;
@@ -2,8 +2,8 @@
 
 #include <cstdint>
 #include <complex>
+#include <format>
 #include <optional>
-#include <ostream>
 #include <utility>
 #include <vector>
 
@@ -16,6 +16,8 @@
 
 #define ADC_FULL_SCALE 179.0f // 127*1.41 (max vector magnitude of the two adcs)
 
+// default samples per symbol of the build; the DSP classes below are
+// compiled for 2, 4 and 8, binaries may pick any of them at startup
 #ifndef SAMPLES_PER_SYMBOL
 #define SAMPLES_PER_SYMBOL 4
 #endif
@@ -28,9 +30,23 @@
 #define SAMPLE_RATE (SYMBOL_RATE * SAMPLES_PER_SYMBOL)
 #endif
 
+// 2, 4 or 8 (see the explicit instantiations in frame.cpp and receiver.cpp)
+constexpr bool supported_samples_per_symbol(int samples_per_symbol) {
+    return samples_per_symbol == 2 || samples_per_symbol == 4 || samples_per_symbol == 8;
+}
+
+// samples per symbol of the preamble search; faster inputs are decimated
+// to this rate first, only the symbol reader runs at the full rate
+#ifndef PREAMBLE_SEARCH_SPS
+#define PREAMBLE_SEARCH_SPS 2
+#endif
+
 // result of a preamble detection: matched protocol + its match metric
 using DetectionResult = std::pair<TransponderProtocol, float>;
 
+// the match threshold a detector starts with (PREAMBLE_THRESHOLD)
+float default_preamble_threshold(TransponderProtocol protocol);
+
 struct Frame {
     TransponderProtocol transponder_protocol; // what kind of preamble was matched
     uint32_t preamble_size;
@@ -46,6 +62,8 @@ struct Frame {
     std::vector<std::complex<float>> symbols;
     // decoding error accumulator
     float evm_sum = 0;
+    // soft-bit confidence accumulator, sum of |2*softbit - 255|
+    uint32_t confidence_sum = 0;
 
     // frame timing, 2 types of time is tracked:
     // - timestamp is an OS-provided steady-time, subject to scheduler's jitter
@@ -63,18 +81,41 @@ struct Frame {
     Frame(TransponderProtocol transponder_protocol, float preamble_metric, uint64_t timestamp, uint64_t timecode);
 
     const uint8_t* bits();
+    // position of the preamble in the first 32 soft bits, -1 if it is not
+    // there; <inverted>: found in the inverted bits (BPSK phase ambiguity)
+    int find_preamble(bool *inverted) const;
     float rssi() const;
     float evm() const;
     float symbol_magnitude() const;
 };
 
-std::ostream& operator <<(std::ostream& os, const Frame& f);
+enum class FrameOutcome : uint8_t {
+    NO_SYNC = 0,  // start-of-frame bits not found
+    REJECTED = 1, // failed decoding (CRC, validation, unknown RC4 code...)
+    DECODED = 2,  // accepted as a transponder message
+};
 
-class FrameDetector {
-    static constexpr int samples_per_symbol = SAMPLES_PER_SYMBOL;
+// monitor-mode representation ("F" lines), formatted without temporaries
+template <>
+struct std::formatter<Frame> {
+    constexpr auto parse(std::format_parse_context& ctx) { return ctx.begin(); }
+    std::format_context::iterator format(const Frame& f, std::format_context& ctx) const;
+};
 
-    std::complex<int32_t> last_samples[samples_per_symbol] = {0};
-    CircBuff<uint16_t> buffers[samples_per_symbol];
+// Preamble search on the differential products of the symbol phases. Inputs
+// above PREAMBLE_SEARCH_SPS go through a polyphase (integrate-and-dump)
+// decimator first: the search does not need the timing resolution of the
+// full rate, the symbol reader re-times the frame on the full-rate samples.
+template<int SPS>
+class FrameDetector {
+    static constexpr int samples_per_symbol = SPS;
+    static constexpr int search_phases = (SPS < PREAMBLE_SEARCH_SPS) ? SPS : PREAMBLE_SEARCH_SPS;
+    static constexpr int decimation = SPS / search_phases;
+    static_assert(SPS % search_phases == 0, "PREAMBLE_SEARCH_SPS must divide the samples per symbol");
+
+    std::complex<int32_t> last_samples[search_phases] = {0};
+    CircBuff<uint16_t> buffers[search_phases];
+    float thresholds[3]; // preamble match thresholds, by TransponderProtocol
     
     // stream statistics:
     std::complex<int32_t> offset= {0, 0}; // dc offset ~ sample mean
@@ -86,6 +127,9 @@ class FrameDetector {
     uint32_t s2 = 0; // sum of sample squared
     int n = 0; // number of samples measured
 public:
+    FrameDetector();
+
+    // a symbol worth of samples (SPS)
     std::optional<DetectionResult> process_baseband(const std::complex<int8_t> *samples);
     void update_statistics();
     void reset_statistics_counters();
@@ -93,16 +137,24 @@ public:
     float symbol_energy() const;
     float noise_energy() const;
     std::complex<float> dc_offset() const;
+
+    float preamble_threshold(TransponderProtocol protocol) const { return thresholds[static_cast<int>(protocol)]; }
+    void set_preamble_threshold(TransponderProtocol protocol, float threshold) { thresholds[static_cast<int>(protocol)] = threshold; }
 };
 
-class SymbolReader {
-public:
-    static constexpr int samples_per_symbol = SAMPLES_PER_SYMBOL;
+// symbol timing of the equalizer, the same at every sample rate
+struct SymbolWindow {
     static constexpr int fseq_halflen = 1;                       // symbols of past/future context
     static constexpr int fseq_syms = 2 * fseq_halflen + 1;       // total filter span (symbols)
     static constexpr int preamble_length = 16;
     // window = fseq_halflen lead + preamble + fseq_halflen trailing (future) symbols
     static constexpr int preamble_symbol_count = preamble_length + 2 * fseq_halflen;
+};
+
+template<int SPS>
+class SymbolReader : public SymbolWindow {
+public:
+    static constexpr int samples_per_symbol = SPS;
     static constexpr int preamble_buffer_size = preamble_symbol_count * samples_per_symbol;
     static constexpr int reserve_buffer_size = preamble_buffer_size;
     
@@ -139,6 +191,11 @@ public:
     void read_symbol(Frame *dst, const std::complex<int8_t> *src, std::complex<float> dc_offset);
     void update_reserve_buffer(const std::complex<int8_t> *src, int end);
     bool is_frame_complete(const Frame *f);
+    // false if the frame being read is hopeless and should be abandoned: the
+    // preamble is not in its first 32 bits, or its symbols look like noise.
+    // *outcome: NO_SYNC (a false trigger) until the preamble is confirmed,
+    // REJECTED after
+    bool is_frame_viable(const Frame *f, FrameOutcome *outcome) const;
 
 private:
     void costas_tune_correction(Frame *frame, std::complex<float> symbol);
@@ -0,0 +1,106 @@
+#include "frame_record.hpp"
+
+#include <cstring>
+#include <numbers>
+#include <string_view>
+
+#include "logger.hpp"
+
+#define FRAME_RECORD_FILE_BUFFER (1u << 20)
+
+FrameRecorder::~FrameRecorder() {
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+}
+
+bool FrameRecorder::open_file(const std::string& path) {
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    // records are small; let stdio batch them into large writes
+    std::setvbuf(file, nullptr, _IOFBF, FRAME_RECORD_FILE_BUFFER);
+    std::fwrite(FRAME_RECORD_MAGIC, 1, std::strlen(FRAME_RECORD_MAGIC), file);
+    return true;
+}
+
+void FrameRecorder::open_socket(const std::string& address) {
+    publisher = std::make_unique<Publisher>(address);
+}
+
+template <typename T>
+static void put(std::vector<uint8_t>& buffer, const T& value) {
+    const size_t offset = buffer.size();
+    buffer.resize(offset + sizeof(T));
+    std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+void FrameRecorder::serialize(const Frame& frame, FrameOutcome outcome, uint8_t loop) {
+    // the buffer keeps its capacity, so there is no allocation after the first few frames
+    buffer.clear();
+    buffer.push_back('F'); // topic; skipped when writing to file
+    put<uint16_t>(buffer, 0); // size, patched below
+    put<uint8_t>(buffer, static_cast<uint8_t>(frame.transponder_protocol));
+    put<uint8_t>(buffer, static_cast<uint8_t>(outcome));
+    put<uint32_t>(buffer, fields);
+    put<uint8_t>(buffer, loop);
+
+    if (fields & FRAME_FIELD_TIMECODE) {
+        put<uint64_t>(buffer, frame.timecode);
+    }
+    if (fields & FRAME_FIELD_TIMESTAMP) {
+        put<uint64_t>(buffer, frame.timestamp);
+    }
+    if (fields & FRAME_FIELD_METRIC) {
+        put<float>(buffer, frame.preamble_metric);
+    }
+    if (fields & FRAME_FIELD_RSSI) {
+        put<float>(buffer, frame.rssi());
+    }
+    if (fields & FRAME_FIELD_EVM) {
+        put<float>(buffer, frame.evm());
+    }
+    if (fields & FRAME_FIELD_FREQ) {
+        put<float>(buffer, frame.phase_per_symbol / (2.0f * std::numbers::pi_v<float>) * SYMBOL_RATE);
+    }
+    if (fields & FRAME_FIELD_SOFTBITS) {
+        put<uint16_t>(buffer, static_cast<uint16_t>(frame.softbits.size()));
+        buffer.insert(buffer.end(), frame.softbits.begin(), frame.softbits.end());
+    }
+    if (fields & FRAME_FIELD_SYMBOLS) {
+        put<uint16_t>(buffer, static_cast<uint16_t>(frame.symbols.size()));
+        for (const auto& symbol : frame.symbols) {
+            put<float>(buffer, symbol.real());
+            put<float>(buffer, symbol.imag());
+        }
+    }
+
+    const uint16_t size = static_cast<uint16_t>(buffer.size() - 1);
+    std::memcpy(buffer.data() + 1, &size, sizeof(size));
+}
+
+void FrameRecorder::poll_subscriptions() {
+    if (publisher) {
+        publisher->poll_subscriptions();
+    }
+}
+
+void FrameRecorder::write(const Frame& frame, FrameOutcome outcome, uint8_t loop) {
+    const bool subscribed = publisher && publisher->is_subscribed('F');
+    if (file == nullptr && !subscribed) {
+        return;
+    }
+
+    serialize(frame, outcome, loop);
+    if (file != nullptr) {
+        if (std::fwrite(buffer.data() + 1, 1, buffer.size() - 1, file) != buffer.size() - 1) {
+            log_err("Frame record file can not be written, frame recording stopped");
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+    if (subscribed) {
+        publisher->send(std::string_view(reinterpret_cast<const char*>(buffer.data()), buffer.size()));
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frame.hpp"
+#include "publisher.hpp"
+
+// Binary per-frame diagnostic records, a compact alternative to the text
+// monitor mode. Every record starts with a fixed header, followed by the
+// fields enabled in the mask, in the order of their bits:
+//
+//   <size:u16> <protocol:u8> <outcome:u8> <fields:u32> <loop:u8>
+//   TIMECODE   <timecode:u64>      samples since startup
+//   TIMESTAMP  <timestamp:u64>     us, steady clock since startup (offline: sample counter)
+//   METRIC     <metric:f32>        preamble match metric
+//   RSSI       <rssi:f32>          dBFS
+//   EVM        <evm:f32>
+//   FREQ       <offset:f32>        Hz
+//   SOFTBITS   <count:u16> <count x u8>
+//   SYMBOLS    <count:u16> <count x (re:f32, im:f32)>
+//
+// All values are in host byte order; <size> covers the full record. <loop>
+// is the radio (loop) the frame was received on, as in the text protocol.
+// Records are appended to a file (after an 8-byte magic) and/or published on
+// a dedicated ZeroMQ socket, prefixed with the "F" topic byte.
+
+#define FRAME_RECORD_MAGIC "OSFRAME2"
+
+enum FrameRecordField : uint32_t {
+    FRAME_FIELD_TIMECODE  = 1u << 0,
+    FRAME_FIELD_TIMESTAMP = 1u << 1,
+    FRAME_FIELD_METRIC    = 1u << 2,
+    FRAME_FIELD_RSSI      = 1u << 3,
+    FRAME_FIELD_EVM       = 1u << 4,
+    FRAME_FIELD_FREQ      = 1u << 5,
+    FRAME_FIELD_SOFTBITS  = 1u << 6,
+    FRAME_FIELD_SYMBOLS   = 1u << 7,
+};
+
+// everything but the bulky soft bits and symbols
+#define FRAME_FIELDS_DEFAULT 0x3fu
+
+class FrameRecorder {
+    uint32_t fields = FRAME_FIELDS_DEFAULT;
+    std::FILE* file = nullptr;
+    std::unique_ptr<Publisher> publisher;
+    std::vector<uint8_t> buffer; // reused between records
+
+    void serialize(const Frame& frame, FrameOutcome outcome, uint8_t loop);
+
+public:
+    FrameRecorder() = default;
+    ~FrameRecorder();
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    void set_fields(uint32_t mask) { fields = mask; }
+    bool open_file(const std::string& path);
+    void open_socket(const std::string& address);
+    bool is_enabled() const { return file != nullptr || publisher != nullptr; }
+
+    // pick up clients (un)subscribing; called from the reporting loop, so the
+    // DSP thread only reads the cached subscription state
+    void poll_subscriptions();
+    // called from the DSP thread for every completed frame
+    void write(const Frame& frame, FrameOutcome outcome, uint8_t loop);
+};
@@ -0,0 +1,288 @@
+#include "generator.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <numbers>
+#include <string_view>
+
+#include "rc4.hpp"
+
+#define GENERATOR_RC4_CODES 16        // codes per RC4 transponder, unless given
+#define GENERATOR_EDGE_DB -30.0f      // crossing envelope at the edges of the detection field
+#define GENERATOR_DIP_WIDTH 0.15f     // null above the loop wire, relative to the field width
+#define GENERATOR_DIP_DEPTH 0.9f
+#define GENERATOR_TIMESYNC_RATE 10000 // transponder timer (Hz)
+
+std::vector<float> frame_symbols(TransponderProtocol protocol, const uint8_t* payload_softbits) {
+    const auto& props = transponder_props(protocol);
+
+    std::vector<float> symbols(GENERATOR_INIT_SYMBOLS, -1.0f);
+    symbols.insert(symbols.end(), props.preamble_syms.begin(), props.preamble_syms.end());
+    for (size_t i = 0; i < props.payload_size; i++) {
+        symbols.push_back(payload_softbits[i] > 127 ? 1.0f : -1.0f);
+    }
+    for (int i = 0; i < GENERATOR_TAIL_SYMBOLS; i++) {
+        symbols.push_back((i % 2) ? -1.0f : 1.0f);
+    }
+    return symbols;
+}
+
+SignalGenerator::SignalGenerator(GeneratorConfig _config)
+    : config(std::move(_config)),
+      sample_rate(static_cast<double>(SYMBOL_RATE) * config.samples_per_symbol),
+      noise_rng(config.seed),
+      gauss(0.0f, 1.0f) {
+    for (size_t i = 0; i < config.transponders.size(); i++) {
+        const GeneratedTransponder& transponder = config.transponders[i];
+        TransponderState state;
+        state.rng.seed(config.seed + 1 + static_cast<uint32_t>(i));
+        state.phase = std::uniform_real_distribution<float>(0.0f, 2.0f * std::numbers::pi_v<float>)(state.rng);
+        state.next_frame = active_from(transponder)
+            + std::uniform_real_distribution<double>(0.0, transponder.frame_interval)(state.rng);
+        state.next_timesync = state.next_frame;
+
+        state.rc4_payloads = transponder.rc4_payloads;
+        if (state.rc4_payloads.empty()) {
+            std::mt19937_64 codes(transponder.transponder_id);
+            for (int c = 0; c < GENERATOR_RC4_CODES; c++) {
+                state.rc4_payloads.push_back(codes());
+            }
+        }
+        states.push_back(std::move(state));
+    }
+}
+
+double SignalGenerator::active_from(const GeneratedTransponder& transponder) const {
+    if (transponder.crossing_duration <= 0.0) {
+        return 0.0;
+    }
+    return std::max(0.0, transponder.crossing_time - transponder.crossing_duration / 2.0);
+}
+
+double SignalGenerator::active_until(const GeneratedTransponder& transponder) const {
+    if (transponder.crossing_duration <= 0.0) {
+        return INFINITY;
+    }
+    return transponder.crossing_time + transponder.crossing_duration / 2.0;
+}
+
+// Loop crossing: the signal rises while the car approaches the loop, nearly
+// vanishes right above the loop wire, then fades away again.
+float SignalGenerator::envelope(const GeneratedTransponder& transponder, double t) const {
+    if (transponder.crossing_duration <= 0.0) {
+        return 1.0f;
+    }
+    const float x = static_cast<float>(2.0 * (t - transponder.crossing_time) / transponder.crossing_duration);
+    if (std::abs(x) > 1.0f) {
+        return 0.0f;
+    }
+    const float field = std::pow(10.0f, GENERATOR_EDGE_DB * x * x / 20.0f);
+    const float dip = 1.0f - GENERATOR_DIP_DEPTH * std::exp(-(x * x) / (GENERATOR_DIP_WIDTH * GENERATOR_DIP_WIDTH));
+    return field * dip;
+}
+
+bool SignalGenerator::finished() const {
+    if (!pending.empty()) {
+        return false; // a burst is still ringing out
+    }
+    for (size_t i = 0; i < states.size(); i++) {
+        if (states[i].next_frame < active_until(config.transponders[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SignalGenerator::render_frame(size_t index, double t) {
+    const GeneratedTransponder& transponder = config.transponders[index];
+    TransponderState& state = states[index];
+
+    GeneratedFrame frame;
+    frame.protocol = transponder.protocol;
+    frame.transponder_id = transponder.transponder_id;
+
+    uint8_t softbits[128];
+    switch (transponder.protocol) {
+        case TransponderProtocol::OpenStint:
+        frame.message = transponder.transponder_id;
+        if (transponder.timesync && t >= state.next_timesync) {
+            const uint64_t timer = static_cast<uint64_t>(t * GENERATOR_TIMESYNC_RATE);
+            frame.message = 0x00A00000u | (timer & 0x000FFFFFu);
+            state.next_timesync += 1.0;
+        }
+        encode_openstint(static_cast<uint32_t>(frame.message), softbits);
+        break;
+        case TransponderProtocol::RC3:
+        frame.message = transponder.transponder_id;
+        encode_rc3(transponder.transponder_id, transponder.rc3_status, softbits);
+        break;
+        case TransponderProtocol::RC4:
+        frame.message = state.rc4_payloads[state.rc4_index++ % state.rc4_payloads.size()];
+        encode_rc4(frame.message, softbits);
+        break;
+    }
+
+    const float gain = envelope(transponder, t);
+    if (gain <= 0.0f) {
+        return;
+    }
+    const float amplitude = ADC_FULL_SCALE * std::pow(10.0f, transponder.rssi / 20.0f) * gain;
+    const double start = t * sample_rate;
+    frame.timecode = static_cast<uint64_t>(start) + GENERATOR_INIT_SYMBOLS * config.samples_per_symbol;
+    frame.rssi = transponder.rssi + 20.0f * std::log10(gain);
+    frames.push_back(frame);
+
+    render(frame_symbols(transponder.protocol, softbits), start, amplitude, state.phase, transponder.frequency_offset, state.rng);
+}
+
+void SignalGenerator::render(const std::vector<float>& symbols, double start, float amplitude, float phase, float frequency_offset, std::mt19937& rng) {
+    const int sps = config.samples_per_symbol;
+    const uint64_t first = static_cast<uint64_t>(start);
+    const float fraction = static_cast<float>(start - static_cast<double>(first)); // sub-sample timing
+
+    // symbol edges (in samples from the first sample), with jitter
+    std::normal_distribution<float> jitter(0.0f, config.timing_jitter * sps);
+    std::vector<float> edges(symbols.size() + 1);
+    for (size_t k = 0; k < edges.size(); k++) {
+        const float j = (config.timing_jitter > 0.0f) ? std::clamp(jitter(rng), -0.3f * sps, 0.3f * sps) : 0.0f;
+        edges[k] = fraction + static_cast<float>(k * sps) + ((k == 0) ? 0.0f : j);
+    }
+
+    // the transmitter's LC tank: first-order low-pass, lets the burst ring out
+    const float tau = config.tank_time_constant * sps;
+    const float alpha = (tau > 0.0f) ? 1.0f - std::exp(-1.0f / tau) : 1.0f;
+    const size_t ringing = static_cast<size_t>(std::ceil(5.0f * tau));
+    const size_t length = static_cast<size_t>(std::ceil(edges.back())) + ringing;
+
+    const size_t offset = first - next_sample;
+    if (pending.size() < offset + length) {
+        pending.resize(offset + length, { 0.0f, 0.0f });
+    }
+
+    const double omega = 2.0 * std::numbers::pi * frequency_offset / sample_rate;
+    float y = 0.0f;
+    size_t k = 0;
+    for (size_t n = 0; n < length; n++) {
+        const float t = static_cast<float>(n);
+        while (k < symbols.size() && t >= edges[k + 1]) {
+            k++;
+        }
+        const float x = (t >= edges[0] && k < symbols.size()) ? symbols[k] : 0.0f;
+        y += alpha * (x - y);
+
+        // the phase is continuous in absolute time: it is the transponder's oscillator
+        const double p = phase + omega * static_cast<double>(first + n);
+        const float carrier = static_cast<float>(std::fmod(p, 2.0 * std::numbers::pi));
+        pending[offset + n] += amplitude * y * std::complex<float>(std::cos(carrier), std::sin(carrier));
+    }
+}
+
+void SignalGenerator::schedule(uint64_t until) {
+    for (size_t i = 0; i < states.size(); i++) {
+        const GeneratedTransponder& transponder = config.transponders[i];
+        TransponderState& state = states[i];
+        const double end = active_until(transponder);
+        std::uniform_real_distribution<double> jitter(-transponder.frame_jitter, transponder.frame_jitter);
+        while (state.next_frame < end && state.next_frame * sample_rate < static_cast<double>(until)) {
+            render_frame(i, state.next_frame);
+            state.next_frame += std::max(transponder.frame_interval + jitter(state.rng), 1e-6);
+        }
+    }
+}
+
+void SignalGenerator::generate(std::complex<float>* out, size_t sample_count) {
+    schedule(next_sample + sample_count);
+    if (pending.size() < sample_count) {
+        pending.resize(sample_count, { 0.0f, 0.0f });
+    }
+
+    // AWGN, relative to the full scale; split evenly between I and Q
+    const float sigma = ADC_FULL_SCALE * std::pow(10.0f, config.noise / 20.0f) / std::numbers::sqrt2_v<float>;
+    for (size_t i = 0; i < sample_count; i++) {
+        out[i] = pending[i] + config.dc_offset + std::complex<float>(sigma * gauss(noise_rng), sigma * gauss(noise_rng));
+    }
+    pending.erase(pending.begin(), pending.begin() + sample_count);
+    next_sample += sample_count;
+}
+
+static int8_t quantize(float x) {
+    return static_cast<int8_t>(std::clamp(std::lround(x), -128l, 127l));
+}
+
+void SignalGenerator::generate_cs8(std::complex<int8_t>* out, size_t sample_count) {
+    std::vector<std::complex<float>> samples(sample_count);
+    generate(samples.data(), sample_count);
+    for (size_t i = 0; i < sample_count; i++) {
+        out[i] = { quantize(samples[i].real()), quantize(samples[i].imag()) };
+    }
+}
+
+void SignalGenerator::generate_cu8(uint8_t* out, size_t sample_count) {
+    // RTL-SDR: unsigned, DC at 128
+    std::vector<std::complex<float>> samples(sample_count);
+    generate(samples.data(), sample_count);
+    for (size_t i = 0; i < sample_count; i++) {
+        out[2*i+0] = static_cast<uint8_t>(quantize(samples[i].real()) + 128);
+        out[2*i+1] = static_cast<uint8_t>(quantize(samples[i].imag()) + 128);
+    }
+}
+
+std::vector<GeneratedFrame> SignalGenerator::take_frames() {
+    std::vector<GeneratedFrame> taken;
+    taken.swap(frames);
+    return taken;
+}
+
+static bool parse_protocol(std::string_view name, TransponderProtocol* protocol) {
+    for (auto p : { TransponderProtocol::OpenStint, TransponderProtocol::RC3, TransponderProtocol::RC4 }) {
+        std::string prefix(transponder_props(p).prefix);
+        std::string lower = prefix;
+        for (auto& c : lower) { c = static_cast<char>(std::tolower(c)); }
+        if (name == prefix || name == lower) {
+            *protocol = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_transponder_spec(const std::string& spec, GeneratedTransponder* t) {
+    const size_t colon = spec.find(':');
+    if (colon == std::string::npos || !parse_protocol(std::string_view(spec).substr(0, colon), &t->protocol)) {
+        return false;
+    }
+    size_t pos = colon + 1;
+    size_t end = spec.find(',', pos);
+    t->transponder_id = static_cast<uint32_t>(std::strtoul(spec.substr(pos, end - pos).c_str(), nullptr, 10));
+
+    while (end != std::string::npos) {
+        pos = end + 1;
+        end = spec.find(',', pos);
+        const std::string option = spec.substr(pos, end - pos);
+        const size_t eq = option.find('=');
+        const std::string key = option.substr(0, eq);
+        const char* value = (eq == std::string::npos) ? "" : option.c_str() + eq + 1;
+        if (key == "rssi") {
+            t->rssi = std::strtof(value, nullptr);
+        } else if (key == "cfo") {
+            t->frequency_offset = std::strtof(value, nullptr);
+        } else if (key == "at") {
+            t->crossing_time = std::strtod(value, nullptr);
+        } else if (key == "dur") {
+            t->crossing_duration = std::strtod(value, nullptr);
+        } else if (key == "interval") {
+            t->frame_interval = std::strtod(value, nullptr) / 1000.0;
+        } else if (key == "status") {
+            t->rc3_status = static_cast<uint8_t>(std::strtoul(value, nullptr, 0));
+        } else if (key == "rc4") {
+            t->rc4_payloads.push_back(std::strtoull(value, nullptr, 16));
+        } else if (key == "sync") {
+            t->timesync = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "frame.hpp"
+#include "transponder.hpp"
+
+// Synthetic IQ generator: renders OpenStint, RC3 and RC4 bursts of any number
+// of (possibly overlapping) transponders, as the radio would receive them.
+// The output is a continuous stream; generate() can be called with any chunk
+// size, and a given configuration (including the seed) always renders the
+// same samples.
+
+#define GENERATOR_INIT_SYMBOLS 4
+#define GENERATOR_TAIL_SYMBOLS 8
+
+struct GeneratedTransponder {
+    TransponderProtocol protocol = TransponderProtocol::OpenStint;
+    uint32_t transponder_id = 1234567;
+    uint8_t rc3_status = 0x00;          // RC3 status byte (low 3 bits 0: regular passing frame)
+    std::vector<uint64_t> rc4_payloads; // RC4 codes, cycled frame by frame; derived from the id if empty
+    bool timesync = false;              // OpenStint: send a time sync message every second
+
+    float rssi = -30.0f;                // peak RSSI (dBFS)
+    float frequency_offset = 0.0f;      // carrier frequency offset (Hz)
+    double crossing_time = 0.5;         // center of the loop crossing (s)
+    double crossing_duration = 0.0;     // time spent in the detection field (s); 0: always on, constant RSSI
+    double frame_interval = 1.5e-3;     // average time between frames (s)
+    double frame_jitter = 0.75e-3;      // uniform random jitter added to the frame interval (s)
+};
+
+struct GeneratorConfig {
+    int samples_per_symbol = SAMPLES_PER_SYMBOL;
+    float noise = -45.0f;                         // AWGN power (dBFS); a transponder's SNR is rssi - noise
+    std::complex<float> dc_offset = { 0.0f, 0.0f }; // ADC units
+    float tank_time_constant = 0.3f;              // LC-tank ringing of the transmitter, ISI (symbols; 0: none)
+    float timing_jitter = 0.02f;                  // standard deviation of the symbol edges (symbols)
+    uint32_t seed = 1;
+    std::vector<GeneratedTransponder> transponders;
+};
+
+// ground truth of a rendered frame
+struct GeneratedFrame {
+    TransponderProtocol protocol;
+    uint32_t transponder_id;
+    uint64_t message;   // OpenStint/RC3: the transmitted id or time sync word, RC4: the payload
+    uint64_t timecode;  // sample index of the first preamble symbol
+    float rssi;         // dBFS, after the crossing envelope
+};
+
+// <protocol>:<id>[,key=value...], ie. "opn:1234567,rssi=-30,at=1.0,dur=0.04"
+// (see openstint_generator -h for the options)
+bool parse_transponder_spec(const std::string& spec, GeneratedTransponder* t);
+
+// BPSK symbols (±1) of a frame: init sequence, preamble, payload, tail
+std::vector<float> frame_symbols(TransponderProtocol protocol, const uint8_t* payload_softbits);
+
+class SignalGenerator {
+    struct TransponderState {
+        double next_frame;      // s
+        double next_timesync;   // s
+        float phase;            // carrier phase at sample 0
+        size_t rc4_index = 0;
+        std::vector<uint64_t> rc4_payloads;
+        std::mt19937 rng;       // per transponder, so the output does not depend on the chunk sizes
+    };
+
+    GeneratorConfig config;
+    double sample_rate;
+    std::mt19937 noise_rng;
+    std::normal_distribution<float> gauss;
+    std::vector<TransponderState> states;
+
+    // rendered bursts, starting at sample next_sample
+    std::vector<std::complex<float>> pending;
+    uint64_t next_sample = 0;
+    std::vector<GeneratedFrame> frames;
+
+    float envelope(const GeneratedTransponder& transponder, double t) const;
+    double active_from(const GeneratedTransponder& transponder) const;
+    double active_until(const GeneratedTransponder& transponder) const;
+    void render_frame(size_t index, double t);
+    void render(const std::vector<float>& symbols, double start, float amplitude, float phase, float frequency_offset, std::mt19937& rng);
+    void schedule(uint64_t until);
+
+public:
+    explicit SignalGenerator(GeneratorConfig config);
+
+    // next sample_count samples in ADC units (int8 range)
+    void generate(std::complex<float>* out, size_t sample_count);
+    // same, quantized as CS8 (HackRF) or as interleaved CU8 (RTL-SDR) bytes
+    void generate_cs8(std::complex<int8_t>* out, size_t sample_count);
+    void generate_cu8(uint8_t* out, size_t sample_count);
+
+    double rate() const { return sample_rate; }
+    uint64_t timecode() const { return next_sample; }
+    // true once every transponder has left the detection field
+    bool finished() const;
+    // ground truth of the frames rendered since the last call
+    std::vector<GeneratedFrame> take_frames();
+};
@@ -0,0 +1,192 @@
+#include "hackrf_source.hpp"
+
+#include <complex>
+#include <cstdio>
+#include <format>
+#include <mutex>
+#include <utility>
+
+#include "logger.hpp"
+
+#include <libhackrf/hackrf.h>
+
+// hackrf_init() once for all the radios, hackrf_exit() after the last one
+static std::mutex library_mutex;
+static int library_users = 0;
+
+static bool acquire_library() {
+    std::lock_guard<std::mutex> lock(library_mutex);
+    if (library_users == 0) {
+        int result = hackrf_init();
+        if (result != HACKRF_SUCCESS) {
+            std::fprintf(stderr, "hackrf_init() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+            return false;
+        }
+    }
+    library_users++;
+    return true;
+}
+
+static void release_library() {
+    std::lock_guard<std::mutex> lock(library_mutex);
+    if (--library_users == 0) {
+        hackrf_exit();
+    }
+}
+
+class HackRFSource : public SampleSource {
+    std::string serial; // empty: first device
+    bool library = false;
+    hackrf_device* device = nullptr;
+    bool started = false;
+    ChunkHandler handler;
+    uint64_t timecode = 0;
+
+    // hackrf callback invoked for each block of data, on the device's transfer
+    // thread (libhackrf runs one per device); rx_ctx is the source
+    static int rx_callback(hackrf_transfer* transfer) {
+        HackRFSource* source = static_cast<HackRFSource*>(transfer->rx_ctx);
+        const uint32_t sample_count = transfer->valid_length / 2;
+        const std::complex<int8_t>* samples = reinterpret_cast<const std::complex<int8_t>*>(transfer->buffer);
+        source->handler({ samples, sample_count, source->timecode, 0 });
+        source->timecode += sample_count;
+        // Returning 0 indicates "keep going".
+        return 0;
+    }
+
+public:
+    explicit HackRFSource(std::string _serial) : serial(std::move(_serial)) {}
+    ~HackRFSource() override;
+
+    bool open(const HackRFSettings& settings);
+
+    std::string name() const override {
+        return serial.empty() ? "HackRF" : std::format("HackRF {}", serial);
+    }
+    SampleFormat format() const override { return SampleFormat::CS8; }
+    bool start(ChunkHandler handler) override;
+    void stop() override;
+    bool streaming() const override {
+        return started && hackrf_is_streaming(device) == HACKRF_TRUE;
+    }
+};
+
+// open and set up the radio; false on failure (a half-opened device is closed by the destructor)
+bool HackRFSource::open(const HackRFSettings& settings) {
+    int result;
+
+    library = acquire_library();
+    if (!library) {
+        return false;
+    }
+
+    // open the desired (or the first available) device
+    result = hackrf_open_by_serial(serial.empty() ? nullptr : serial.c_str(), &device);
+    if (result != HACKRF_SUCCESS || device == nullptr) {
+        std::fprintf(stderr, "hackrf_open() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+        device = nullptr;
+        return false;
+    }
+
+    read_partid_serialno_t serno;
+    result = hackrf_board_partid_serialno_read(device, &serno);
+    if (result != HACKRF_SUCCESS) {
+        std::fprintf(stderr, "hackrf_board_partid_serialno_read() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+    } else {
+        std::printf("HackRF SerNo.: %08x%08x%08x%08x\n", serno.serial_no[0], serno.serial_no[1], serno.serial_no[2], serno.serial_no[3]);
+    }
+
+    // set center frequency
+    result = hackrf_set_freq(device, settings.freq_hz);
+    if (result != HACKRF_SUCCESS) {
+        std::fprintf(stderr, "hackrf_set_freq() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+        return false;
+    }
+
+    // set sample rate (Hz)
+    result = hackrf_set_sample_rate(device, settings.sample_rate);
+    if (result != HACKRF_SUCCESS) {
+        std::fprintf(stderr, "hackrf_set_sample_rate() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+        return false;
+    }
+
+    // set filter BW (Hz)
+    result = hackrf_set_baseband_filter_bandwidth(device, settings.filter_bw);
+    if (result != HACKRF_SUCCESS) {
+        std::fprintf(stderr, "hackrf_set_baseband_filter_bandwidth() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+        return false;
+    }
+
+    // set LNA gain
+    result = hackrf_set_lna_gain(device, settings.lna_gain);
+    if (result != HACKRF_SUCCESS) {
+        std::fprintf(stderr, "hackrf_set_lna_gain() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+    }
+
+    // set VGA gain
+    result = hackrf_set_vga_gain(device, settings.vga_gain);
+    if (result != HACKRF_SUCCESS) {
+        std::fprintf(stderr, "hackrf_set_vga_gain() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+    }
+
+    // (Optional) enable amplified antenna
+    result = hackrf_set_amp_enable(device, settings.amp_enable ? 1 : 0);
+    if (result != HACKRF_SUCCESS) {
+        std::fprintf(stderr, "hackrf_set_amp_enable() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+    }
+
+    // (Optional) enable bias-tee
+    result = hackrf_set_antenna_enable(device, settings.bias_tee ? 1 : 0);
+    if (result != HACKRF_SUCCESS) {
+        std::fprintf(stderr, "hackrf_set_antenna_enable() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+    }
+
+    return true;
+}
+
+HackRFSource::~HackRFSource() {
+    stop();
+    if (device != nullptr) {
+        int result = hackrf_close(device);
+        if (result != HACKRF_SUCCESS) {
+            std::fprintf(stderr, "hackrf_close() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+        }
+        device = nullptr;
+    }
+    if (library) {
+        release_library();
+    }
+}
+
+bool HackRFSource::start(ChunkHandler _handler) {
+    stop();
+    handler = std::move(_handler);
+    // start receiving (callback provides raw interleaved I/Q samples)
+    int result = hackrf_start_rx(device, rx_callback, this);
+    if (result != HACKRF_SUCCESS) {
+        std::fprintf(stderr, "hackrf_start_rx() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+        return false;
+    }
+    started = true;
+    return true;
+}
+
+void HackRFSource::stop() {
+    if (!started) {
+        return;
+    }
+    // stop RX
+    int result = hackrf_stop_rx(device);
+    if (result != HACKRF_SUCCESS) {
+        std::fprintf(stderr, "hackrf_stop_rx() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
+    }
+    started = false;
+}
+
+std::unique_ptr<SampleSource> make_hackrf_source(const std::string& serial, const HackRFSettings& settings) {
+    auto source = std::make_unique<HackRFSource>(serial);
+    if (!source->open(settings)) {
+        return nullptr;
+    }
+    return source;
+}
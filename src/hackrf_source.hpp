@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "sample_source.hpp"
+
+struct HackRFSettings {
+    uint64_t freq_hz = 5000000;
+    uint32_t sample_rate = SAMPLE_RATE;
+    uint32_t filter_bw = 1750000;
+    uint8_t lna_gain = 24;      // 0-40 in steps of 8
+    uint8_t vga_gain = 20;      // 0-62 in steps of 2
+    bool amp_enable = false;    // +13 dB preamp
+    bool bias_tee = false;
+};
+
+// A HackRF (empty serial: the first one found), opened and tuned; nullptr on
+// failure. libhackrf is initialized while any of them exists.
+std::unique_ptr<SampleSource> make_hackrf_source(const std::string& serial, const HackRFSettings& settings);
@@ -0,0 +1,275 @@
+#include "journal.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <format>
+
+#include "logger.hpp"
+
+#define JOURNAL_MAGIC "OSJRNL01"
+#define JOURNAL_MAGIC_SIZE 8
+#define JOURNAL_RECORD_HEADER 20    // seq + timestamp + length
+#define JOURNAL_GROWTH (1ul << 20)  // grow the file in 1 MiB steps
+#define JOURNAL_REPLY_LIMIT 10000   // max. messages per catch-up reply
+
+static size_t record_size(size_t message_length) {
+    return (JOURNAL_RECORD_HEADER + message_length + 7) & ~static_cast<size_t>(7);
+}
+
+bool Journal::open(const std::string& path) {
+    if (!file.open(path, true)) {
+        return false;
+    }
+
+    if (file.size() < JOURNAL_MAGIC_SIZE) {
+        // new journal
+        if (!file.resize(JOURNAL_GROWTH)) {
+            return false;
+        }
+        std::memcpy(file.data(), JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE);
+        file_used = JOURNAL_MAGIC_SIZE;
+        file_first_seq = next_seq;
+        return true;
+    }
+    if (std::memcmp(file.data(), JOURNAL_MAGIC, JOURNAL_MAGIC_SIZE) != 0) {
+        log_err("'{}' is not a journal file", path);
+        file.close();
+        return false;
+    }
+
+    // existing journal: rebuild the offset and time index, continue numbering
+    size_t offset = JOURNAL_MAGIC_SIZE;
+    while (offset + JOURNAL_RECORD_HEADER <= file.size()) {
+        JournalEntry entry;
+        uint32_t length;
+        std::memcpy(&entry.seq, file.data() + offset, sizeof(uint64_t));
+        std::memcpy(&entry.timestamp, file.data() + offset + 8, sizeof(uint64_t));
+        std::memcpy(&length, file.data() + offset + 16, sizeof(uint32_t));
+        if (entry.seq == 0 || offset + record_size(length) > file.size()) {
+            break; // end of journal (or a torn write)
+        }
+        if (file_records == 0) {
+            file_first_seq = entry.seq;
+        }
+        index_record(offset);
+        if (length > 0 && file.data()[offset + JOURNAL_RECORD_HEADER] == 'P') {
+            index_passing(entry.timestamp, entry.seq);
+        }
+        next_seq = entry.seq + 1;
+        offset += record_size(length);
+    }
+    if (file_records == 0) {
+        file_first_seq = next_seq;
+    }
+    file_used = offset;
+    return true;
+}
+
+void Journal::write_record(const JournalEntry& entry) {
+    const size_t size = record_size(entry.message.size());
+    if (file_used + size > file.size()) {
+        if (!file.resize(file.size() + std::max(size, static_cast<size_t>(JOURNAL_GROWTH)))) {
+            log_err("Journal file can not be extended, disk journaling stopped");
+            file.close();
+            return;
+        }
+    }
+
+    uint8_t* record = file.data() + file_used;
+    const uint32_t length = static_cast<uint32_t>(entry.message.size());
+    std::memcpy(record + 8, &entry.timestamp, sizeof(uint64_t));
+    std::memcpy(record + 16, &length, sizeof(uint32_t));
+    std::memcpy(record + JOURNAL_RECORD_HEADER, entry.message.data(), length);
+    // write the sequence number last: a torn record reads as the end of the journal
+    std::memcpy(record, &entry.seq, sizeof(uint64_t));
+
+    index_record(file_used);
+    file_used += size;
+}
+
+void Journal::index_record(size_t offset) {
+    if (file_records % file_stride == 0) {
+        file_offsets.push_back(offset);
+    }
+    file_records++;
+    if (file_offsets.size() > INDEX_SIZE) {
+        // halve the index: keep the offsets of every other indexed record
+        for (size_t i = 0; 2 * i < file_offsets.size(); i++) {
+            file_offsets[i] = file_offsets[2 * i];
+        }
+        file_offsets.resize((file_offsets.size() + 1) / 2);
+        file_stride *= 2;
+    }
+}
+
+bool Journal::read_record(uint64_t seq, JournalEntry* entry) const {
+    if (!file.is_open() || seq < file_first_seq || seq - file_first_seq >= file_records) {
+        return false;
+    }
+    const uint64_t index = seq - file_first_seq;
+    const uint8_t* record = file.data() + file_offsets[index / file_stride];
+    uint32_t length;
+    for (uint64_t skip = index % file_stride; skip > 0; skip--) {
+        std::memcpy(&length, record + 16, sizeof(uint32_t));
+        record += record_size(length);
+    }
+    std::memcpy(&entry->seq, record, sizeof(uint64_t));
+    std::memcpy(&entry->timestamp, record + 8, sizeof(uint64_t));
+    std::memcpy(&length, record + 16, sizeof(uint32_t));
+    entry->message.assign(reinterpret_cast<const char*>(record + JOURNAL_RECORD_HEADER), length);
+    return true;
+}
+
+void Journal::index_passing(uint64_t timestamp, uint64_t seq) {
+    passing_order.push_back(passing_index.emplace(timestamp, seq));
+    if (passing_order.size() > INDEX_SIZE) {
+        // the oldest passing goes, whatever its timestamp (clock steps, a
+        // previous run's timebase in the file)
+        passing_index.erase(passing_order.front());
+        passing_order.pop_front();
+    }
+}
+
+uint64_t Journal::append(uint64_t timestamp, std::string_view message) {
+    JournalEntry entry = { next_seq++, timestamp, std::string(message) };
+    if (file.is_open()) {
+        write_record(entry);
+    }
+    if (!entry.message.empty() && entry.message.front() == 'P') {
+        index_passing(entry.timestamp, entry.seq);
+    }
+
+    ring.push_back(std::move(entry));
+    if (ring.size() > RING_SIZE) {
+        const JournalEntry& evicted = ring.front();
+        if (!file.is_open() && !passing_order.empty() && passing_order.front()->second == evicted.seq) {
+            // without a disk journal, the evicted passing can not be looked up
+            // anymore; passings are indexed in order, it is the oldest one
+            passing_index.erase(passing_order.front());
+            passing_order.pop_front();
+        }
+        ring.pop_front();
+    }
+    return ring.back().seq;
+}
+
+std::vector<JournalEntry> Journal::since(uint64_t seq, size_t limit) const {
+    std::vector<JournalEntry> entries;
+    const uint64_t ring_first_seq = ring.empty() ? next_seq : ring.front().seq;
+
+    // older messages come from the disk journal, if there is one
+    JournalEntry entry;
+    const uint64_t first_seq = file.is_open() ? file_first_seq : ring_first_seq;
+    for (uint64_t s = std::max(seq + 1, first_seq); s < ring_first_seq && entries.size() < limit; s++) {
+        if (read_record(s, &entry)) {
+            entries.push_back(entry);
+        }
+    }
+    for (uint64_t s = std::max(seq + 1, ring_first_seq); s < next_seq && entries.size() < limit; s++) {
+        entries.push_back(ring[s - ring_first_seq]);
+    }
+    return entries;
+}
+
+std::vector<JournalEntry> Journal::passings_between(uint64_t timestamp_from, uint64_t timestamp_until, size_t limit) const {
+    std::vector<JournalEntry> entries;
+    const uint64_t ring_first_seq = ring.empty() ? next_seq : ring.front().seq;
+
+    auto first = passing_index.lower_bound(timestamp_from);
+    auto last = passing_index.upper_bound(timestamp_until);
+    JournalEntry entry;
+    for (auto it = first; it != last && entries.size() < limit; ++it) {
+        const uint64_t seq = it->second;
+        if (seq >= ring_first_seq) {
+            entries.push_back(ring[seq - ring_first_seq]);
+        } else if (read_record(seq, &entry)) {
+            entries.push_back(entry);
+        }
+    }
+    return entries;
+}
+
+JournalServer::JournalServer(const std::string& address, const Journal& _journal)
+    : context(1), socket(context, zmq::socket_type::router), journal(_journal) {
+    socket.bind(address);
+}
+
+static bool parse_uint64(std::string_view token, uint64_t* value) {
+    auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), *value);
+    return ec == std::errc() && ptr == token.data() + token.size();
+}
+
+static std::vector<std::string_view> split(std::string_view s) {
+    std::vector<std::string_view> tokens;
+    size_t pos = 0;
+    while (pos < s.size()) {
+        size_t end = s.find(' ', pos);
+        if (end == std::string_view::npos) { end = s.size(); }
+        if (end > pos) { tokens.push_back(s.substr(pos, end - pos)); }
+        pos = end + 1;
+    }
+    return tokens;
+}
+
+std::vector<std::string> JournalServer::handle(std::string_view request) const {
+    const auto tokens = split(request);
+
+    std::vector<JournalEntry> entries;
+    uint64_t a, b;
+    if (tokens.size() == 2 && tokens[0] == "SINCE" && parse_uint64(tokens[1], &a)) {
+        entries = journal.since(a, JOURNAL_REPLY_LIMIT);
+    } else if (tokens.size() == 3 && tokens[0] == "BETWEEN" && parse_uint64(tokens[1], &a) && parse_uint64(tokens[2], &b)) {
+        entries = journal.passings_between(a, b, JOURNAL_REPLY_LIMIT);
+    } else {
+        return { "E unknown request" };
+    }
+
+    std::vector<std::string> reply;
+    reply.reserve(entries.size() + 1);
+    reply.push_back(std::format("J {} {}", journal.last_seq(), entries.size()));
+    for (const auto& entry : entries) {
+        reply.push_back(std::format("{} {}", entry.seq, entry.message));
+    }
+    return reply;
+}
+
+void JournalServer::poll() {
+    while (true) {
+        // read a full multipart request: <identity> [<empty delimiter>] <body>
+        std::vector<zmq::message_t> frames;
+        zmq::message_t msg;
+        if (!socket.recv(msg, zmq::recv_flags::dontwait)) {
+            return;
+        }
+        bool more = msg.more();
+        frames.push_back(std::move(msg));
+        while (more) {
+            zmq::message_t part;
+            if (!socket.recv(part, zmq::recv_flags::none)) { break; }
+            more = part.more();
+            frames.push_back(std::move(part));
+        }
+        if (frames.size() < 2) {
+            continue; // malformed
+        }
+
+        // REQ clients put an empty delimiter after the routing envelope, DEALER might not
+        size_t body = 1;
+        for (size_t i = 1; i < frames.size() - 1; i++) {
+            if (frames[i].size() == 0) {
+                body = i + 1;
+                break;
+            }
+        }
+
+        const std::vector<std::string> reply = handle(frames[body].to_string_view());
+        for (size_t i = 0; i < body; i++) {
+            socket.send(frames[i], zmq::send_flags::sndmore);
+        }
+        for (size_t i = 0; i < reply.size(); i++) {
+            const bool last = (i + 1 == reply.size());
+            socket.send(zmq::buffer(reply[i]), last ? zmq::send_flags::none : zmq::send_flags::sndmore);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <zmq.hpp>
+
+#include "mapped_file.hpp"
+
+struct JournalEntry {
+    uint64_t seq;       // monotonically increasing sequence number
+    uint64_t timestamp; // the message's reporting timestamp (ms)
+    std::string message;
+};
+
+// Journal of every emitted message. The most recent messages are kept in an
+// in-memory ring; optionally, all of them are appended to a memory-mapped file
+// as well. Passings are indexed by their timestamp for time range queries.
+//
+// On-disk format: an 8-byte magic, followed by records of
+//   <seq:u64> <timestamp:u64> <length:u32> <message bytes> <zero padding to 8 bytes>
+// in host byte order. The file is grown in steps; unused space is zero-filled,
+// and a zero sequence number marks the end of the journal.
+//
+// The indices are bounded: the file offset of every record is kept only up to
+// INDEX_SIZE records, beyond that of every 2nd, 4th, ... record (the ones in
+// between are reached by skipping records); the time index keeps the last
+// INDEX_SIZE passings journaled (by sequence number, not by timestamp).
+class Journal {
+    static constexpr size_t RING_SIZE = 1 << 14;
+    static constexpr size_t INDEX_SIZE = 1 << 18;
+
+    std::deque<JournalEntry> ring;
+    std::multimap<uint64_t, uint64_t> passing_index; // timestamp -> seq
+    std::deque<std::multimap<uint64_t, uint64_t>::iterator> passing_order; // of passing_index, by seq
+    uint64_t next_seq = 1;
+
+    MappedFile file;
+    size_t file_used = 0;
+    uint64_t file_first_seq = 0;
+    uint64_t file_records = 0;
+    uint64_t file_stride = 1;
+    std::vector<uint64_t> file_offsets; // file offset of record (file_first_seq + i*file_stride)
+
+    bool read_record(uint64_t seq, JournalEntry* entry) const;
+    void write_record(const JournalEntry& entry);
+    void index_record(size_t offset);
+    void index_passing(uint64_t timestamp, uint64_t seq);
+
+public:
+    // attach an on-disk journal; an existing journal is continued
+    bool open(const std::string& path);
+    uint64_t append(uint64_t timestamp, std::string_view message);
+
+    uint64_t last_seq() const { return next_seq - 1; }
+    std::vector<JournalEntry> since(uint64_t seq, size_t limit) const;
+    std::vector<JournalEntry> passings_between(uint64_t timestamp_from, uint64_t timestamp_until, size_t limit) const;
+};
+
+// Catch-up endpoint for clients which missed messages on the pub-sub channel.
+// It accepts REQ (or envelope-compatible DEALER) requests:
+//   SINCE <seq>                -> every journaled message after <seq>
+//   BETWEEN <from> <until>     -> passings with from <= timestamp <= until
+// The reply is a header frame "J <last_seq> <count>" followed by <count>
+// frames of "<seq> <message>", or a single "E <reason>" frame on error.
+class JournalServer {
+    zmq::context_t context;
+    zmq::socket_t socket;
+    const Journal& journal;
+
+    std::vector<std::string> handle(std::string_view request) const;
+
+public:
+    JournalServer(const std::string& address, const Journal& journal);
+    JournalServer(const JournalServer&) = delete;
+    JournalServer& operator=(const JournalServer&) = delete;
+
+    // answer pending requests; non-blocking
+    void poll();
+};
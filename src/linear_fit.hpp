@@ -0,0 +1,34 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// Linear regression over a stream of (x, y) points: plain least squares up
+// to <window> points, exponential forgetting after. The sums are centered, so
+// large x values (sample counters, us timestamps) stay precise.
+struct LinearFit {
+    uint64_t count = 0;
+    double mean_x = 0.0;
+    double mean_y = 0.0;
+    double var_x = 0.0;
+    double cov_xy = 0.0;
+    double residual_power = 0.0; // mean squared prediction error of the points added
+
+    double slope() const { return (var_x > 0.0) ? cov_xy / var_x : 0.0; }
+    double predict(double x) const { return mean_y + slope() * (x - mean_x); }
+
+    void add(double x, double y, uint64_t window) {
+        if (count > 1) {
+            const double residual = y - predict(x);
+            residual_power += (residual * residual - residual_power) / static_cast<double>(std::min(count, window));
+        }
+        count++;
+        const double alpha = 1.0 / static_cast<double>(std::min(count, window));
+        const double dx = x - mean_x;
+        const double dy = y - mean_y;
+        mean_x += alpha * dx;
+        mean_y += alpha * dy;
+        var_x = (1.0 - alpha) * (var_x + alpha * dx * dx);
+        cov_xy = (1.0 - alpha) * (cov_xy + alpha * dx * dy);
+    }
+};
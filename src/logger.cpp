@@ -0,0 +1,90 @@
+#include "logger.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#define LOGGER_IDLE_SLEEP_MS 2
+
+static_assert((AsyncLogger::SLOT_COUNT & (AsyncLogger::SLOT_COUNT - 1)) == 0, "SLOT_COUNT must be a power of 2");
+
+AsyncLogger::AsyncLogger() : slots(new Slot[SLOT_COUNT]) {
+    for (size_t i = 0; i < SLOT_COUNT; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    thread = std::thread(&AsyncLogger::run, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+AsyncLogger& AsyncLogger::instance() {
+    static AsyncLogger logger;
+    return logger;
+}
+
+// bounded multi-producer queue (Vyukov): a slot is free for position pos when
+// its sequence equals pos, and holds a line for the consumer when it is pos+1
+AsyncLogger::Slot* AsyncLogger::claim(size_t* pos) {
+    size_t p = enqueue_pos.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = slots[p & (SLOT_COUNT - 1)];
+        const size_t seq = slot.sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(p);
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(p, p + 1, std::memory_order_relaxed)) {
+                *pos = p;
+                return &slot;
+            }
+        } else if (diff < 0) {
+            return nullptr; // full
+        } else {
+            p = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void AsyncLogger::commit(Slot* slot, size_t pos) {
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool AsyncLogger::drain() {
+    bool written = false;
+    while (true) {
+        Slot& slot = slots[dequeue_pos & (SLOT_COUNT - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+            break;
+        }
+        std::fwrite(slot.text, 1, slot.length, slot.stream == LogStream::ERR ? stderr : stdout);
+        slot.sequence.store(dequeue_pos + SLOT_COUNT, std::memory_order_release);
+        dequeue_pos++;
+        written = true;
+    }
+    return written;
+}
+
+void AsyncLogger::run() {
+    uint64_t reported_drops = 0;
+    while (true) {
+        const bool stopping = !running.load();
+        if (drain()) {
+            std::fflush(stdout);
+            std::fflush(stderr);
+        } else if (stopping) {
+            break;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(LOGGER_IDLE_SLEEP_MS));
+        }
+
+        const uint64_t drops = dropped();
+        if (drops != reported_drops) {
+            std::fprintf(stderr, "Console output fell behind, %llu lines dropped\n",
+                static_cast<unsigned long long>(drops - reported_drops));
+            reported_drops = drops;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <thread>
+
+enum class LogStream { OUT, ERR };
+
+// Console output, off the hot path. Lines are formatted straight into the
+// slots of a bounded lock-free queue, and a background thread writes them to
+// stdout/stderr. Producers never block: when the queue is full, the line is
+// dropped and counted, unless the logger is lossless (offline processing,
+// where every line matters more than latency). Overlong lines are truncated.
+class AsyncLogger {
+public:
+    static constexpr size_t SLOT_COUNT = 512; // power of 2
+    static constexpr size_t SLOT_SIZE = 4096; // a monitor-mode frame line fits
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogStream stream;
+        uint32_t length;
+        char text[SLOT_SIZE];
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<size_t> enqueue_pos = 0;
+    alignas(64) size_t dequeue_pos = 0; // logger thread only
+    std::atomic<uint64_t> dropped_lines = 0;
+    std::atomic<bool> running = true;
+    std::atomic<bool> lossless = false;
+    std::thread thread;
+
+    AsyncLogger();
+    Slot* claim(size_t* pos);
+    void commit(Slot* slot, size_t pos);
+    bool drain();
+    void run();
+
+public:
+    ~AsyncLogger();
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    static AsyncLogger& instance();
+
+    template <typename... Args>
+    void write(LogStream stream, std::format_string<Args...> fmt, Args&&... args) {
+        size_t pos;
+        Slot* slot = claim(&pos);
+        while (slot == nullptr && lossless.load(std::memory_order_relaxed)) {
+            std::this_thread::yield(); // wait for the logger thread
+            slot = claim(&pos);
+        }
+        if (slot == nullptr) {
+            dropped_lines.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // keep a byte for the line feed
+        auto result = std::format_to_n(slot->text, SLOT_SIZE - 1, fmt, std::forward<Args>(args)...);
+        slot->length = static_cast<uint32_t>(std::clamp<std::ptrdiff_t>(result.size, 0, SLOT_SIZE - 1));
+        slot->text[slot->length++] = '\n';
+        slot->stream = stream;
+        commit(slot, pos);
+    }
+
+    // wait for a free slot instead of dropping lines
+    void set_lossless(bool enabled) { lossless.store(enabled, std::memory_order_relaxed); }
+
+    uint64_t dropped() const { return dropped_lines.load(std::memory_order_relaxed); }
+};
+
+template <typename... Args>
+void log_out(std::format_string<Args...> fmt, Args&&... args) {
+    AsyncLogger::instance().write(LogStream::OUT, fmt, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+void log_err(std::format_string<Args...> fmt, Args&&... args) {
+    AsyncLogger::instance().write(LogStream::ERR, fmt, std::forward<Args>(args)...);
+}
@@ -0,0 +1,162 @@
+// Sector aggregator: subscribes to several decoders, aligns their timebases on
+// the OpenStint time-sync frames and republishes their passings as a single,
+// time-ordered stream, tagged with the sector they come from.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <zmq.hpp>
+
+#include "aggregator.hpp"
+#include "publisher.hpp"
+#include "logger.hpp"
+
+#define DEFAULT_AGGREGATOR_PORT 5560
+#define DEFAULT_HOLD_MS 1000
+#define POLL_TIMEOUT_MS 50
+#define STATUS_PERIOD_MS 5000
+
+using namespace std::chrono;
+
+static std::atomic<bool> do_exit(false);
+
+void signal_handler(int /*signum*/) {
+    do_exit = true;
+}
+
+static double local_ms() {
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> endpoints;
+    std::vector<std::string> sectors;
+    int port = DEFAULT_AGGREGATOR_PORT;
+    double hold_ms = DEFAULT_HOLD_MS;
+    bool quiet_mode = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-i" && i + 1 < argc) {
+            // endpoint[=sector]
+            std::string input = argv[++i];
+            const size_t eq = input.find('=');
+            endpoints.push_back(input.substr(0, eq));
+            sectors.push_back(eq == std::string::npos ? std::to_string(sectors.size()) : input.substr(eq + 1));
+        } else if (arg == "-p" && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+        } else if (arg == "-H" && i + 1 < argc) {
+            hold_ms = std::atof(argv[++i]);
+        } else if (arg == "-q") {
+            quiet_mode = true;
+        } else {
+            if (arg != "-h") {
+                std::cerr << "Unknown argument: " << arg << "\n";
+            }
+            std::cerr << "Usage: " << argv[0] << " -i endpoint[=sector]... [-p tcp_port] [-H ms] [-q]\n";
+            std::cerr << "\t-i endpoint  \t\t\tDecoder publisher (ie. tcp://10.0.0.2:5556), optionally named; the first one is the reference timebase\n";
+            std::cerr << "\t-p port     default:" << DEFAULT_AGGREGATOR_PORT << "\tZeroMQ publisher port of the merged stream\n";
+            std::cerr << "\t-H ms       default:" << DEFAULT_HOLD_MS << "\tHold passings this long to put them in order (latency)\n";
+            std::cerr << "\t-q          default:off \tQuiet mode (do not echo reports to stdout)\n";
+            return 1;
+        }
+    }
+    if (endpoints.empty()) {
+        std::cerr << "No decoders given (-i)\n";
+        return EXIT_FAILURE;
+    }
+
+    zmq::context_t context(1);
+    std::vector<zmq::socket_t> sockets;
+    for (const auto& endpoint : endpoints) {
+        sockets.emplace_back(context, zmq::socket_type::sub);
+        // passings, time-syncs and status (for the arrival-time estimate) only
+        for (const char* topic : { "P", "T", "S" }) {
+            sockets.back().set(zmq::sockopt::subscribe, topic);
+        }
+        sockets.back().connect(endpoint);
+        log_out("Subscribed to {}", endpoint);
+    }
+    std::vector<zmq::pollitem_t> items;
+    for (auto& socket : sockets) {
+        items.push_back({ socket.handle(), 0, ZMQ_POLLIN, 0 });
+    }
+
+    const std::string address = std::format("tcp://*:{}", port);
+    Publisher publisher(address);
+    log_out("Listening on {}", address);
+
+    SectorAggregator aggregator(sectors, hold_ms);
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    double status_due = local_ms() + STATUS_PERIOD_MS;
+    while (!do_exit) {
+        try {
+            zmq::poll(items, milliseconds(POLL_TIMEOUT_MS));
+        } catch (const zmq::error_t&) {
+            continue; // interrupted by a signal
+        }
+        const double now = local_ms();
+        for (size_t i = 0; i < sockets.size(); i++) {
+            zmq::message_t msg;
+            while ((items[i].revents & ZMQ_POLLIN) && sockets[i].recv(msg, zmq::recv_flags::dontwait)) {
+                aggregator.on_message(i, msg.to_string_view(), now);
+            }
+        }
+
+        publisher.poll_subscriptions();
+        for (const SectorPassing& passing : aggregator.release(now)) {
+            const std::string report = std::format("P {} {} {} {:.2f} {} {} {} {} {} {}",
+                std::llround(passing.timestamp),
+                passing.transponder_type,
+                passing.transponder_id,
+                passing.rssi,
+                passing.hits,
+                passing.duration,
+                passing.loop,
+                passing.gap,
+                aggregator.sector(passing.input),
+                passing.aligned ? 1 : 0
+            );
+            if (!quiet_mode) {
+                log_out("{}", report);
+            }
+            publisher.send(report);
+        }
+
+        // alignment of the inputs, for the timing staff
+        if (now >= status_due) {
+            status_due += STATUS_PERIOD_MS;
+            for (size_t i = 0; i < aggregator.input_count(); i++) {
+                const InputAlignment alignment = aggregator.alignment(i);
+                const std::string report = std::format("A {} {} {} {:.1f} {} {} {}",
+                    std::llround(now),
+                    i,
+                    aggregator.sector(i),
+                    alignment.offset,
+                    alignment.aligned ? 1 : 0,
+                    alignment.passings,
+                    alignment.duplicates
+                );
+                if (!quiet_mode) {
+                    log_out("{}", report);
+                }
+                if (publisher.is_subscribed('A')) {
+                    publisher.send(report);
+                }
+            }
+        }
+    }
+    log_err("Done.");
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "generator.hpp"
+#include "tcp_socket.hpp"
+
+// samples rendered per write
+static const size_t CHUNK_SAMPLES = 1 << 16;
+// samples per chunk sent to an rtl_tcp client (-T), paced one by one
+static const size_t RTL_TCP_CHUNK_SAMPLES = 16384;
+
+static void print_frames(SignalGenerator& generator) {
+    for (const auto& f : generator.take_frames()) {
+        std::fprintf(stderr, "G %s %u %llx %llu %.1f\n", std::string(transponder_props(f.protocol).prefix).c_str(),
+            f.transponder_id, static_cast<unsigned long long>(f.message),
+            static_cast<unsigned long long>(f.timecode), f.rssi);
+    }
+}
+
+// the tuning commands of the client (5 bytes: command, big-endian parameter);
+// there is no radio to tune, only the sample rate matters
+static void read_rtl_tcp_commands(TcpSocket* client, uint32_t sample_rate, std::atomic<bool>* connected) {
+    uint8_t command[5];
+    while (client->recv_all(command, sizeof(command))) {
+        const uint32_t parameter = (static_cast<uint32_t>(command[1]) << 24) | (static_cast<uint32_t>(command[2]) << 16) |
+                                   (static_cast<uint32_t>(command[3]) << 8) | static_cast<uint32_t>(command[4]);
+        if (command[0] == 0x02 && parameter != sample_rate) {
+            std::cerr << "Warning: the client asks for " << parameter << " Hz, generating " << sample_rate << " Hz\n";
+        }
+    }
+    *connected = false;
+}
+
+// A stand-in for rtl_tcp: serves the generated samples (CU8) to a single
+// client, paced to the sample rate, so the network input of the decoders can
+// be tested without a radio.
+static uint64_t serve_rtl_tcp(SignalGenerator& generator, uint16_t port, uint64_t total, bool until_finished, bool verbose) {
+    TcpSocket server;
+    if (!server.listen(port)) {
+        std::cerr << "Failed to listen on port " << port << "\n";
+        return 0;
+    }
+    std::cerr << "rtl_tcp stand-in listening on port " << port << "\n";
+    TcpSocket client = server.accept();
+    if (!client.is_open()) {
+        std::cerr << "Failed to accept a client\n";
+        return 0;
+    }
+    std::cerr << "Client connected\n";
+
+    // "RTL0", tuner type (R828D: no direct sampling), number of gain steps
+    const uint8_t header[12] = { 'R', 'T', 'L', '0', 0, 0, 0, 6, 0, 0, 0, 0 };
+    std::atomic<bool> connected = client.send_all(header, sizeof(header));
+    std::thread commands(read_rtl_tcp_commands, &client, static_cast<uint32_t>(generator.rate()), &connected);
+
+    using clock = std::chrono::steady_clock;
+    const clock::time_point started = clock::now();
+    std::vector<uint8_t> buffer(2 * RTL_TCP_CHUNK_SAMPLES);
+    uint64_t written = 0;
+    while (connected && written < total && (!until_finished || !generator.finished())) {
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(RTL_TCP_CHUNK_SAMPLES, total - written));
+        generator.generate_cu8(buffer.data(), n);
+        if (!client.send_all(buffer.data(), 2 * n)) {
+            break;
+        }
+        written += n;
+        if (verbose) {
+            print_frames(generator);
+        }
+        std::this_thread::sleep_until(started + std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(written / generator.rate())));
+    }
+
+    client.shutdown();
+    commands.join();
+    return written;
+}
+
+int main(int argc, char** argv) {
+    GeneratorConfig config;
+    double duration = 0.0;
+    bool cu8 = false;
+    bool verbose = false;
+    std::string output;
+    int rtl_tcp_port = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-t" && i + 1 < argc) {
+            GeneratedTransponder t;
+            if (!parse_transponder_spec(argv[++i], &t)) {
+                std::cerr << "Invalid transponder: " << argv[i] << "\n";
+                return EXIT_FAILURE;
+            }
+            config.transponders.push_back(t);
+        } else if (arg == "-r" && i + 1 < argc) {
+            config.samples_per_symbol = std::atoi(argv[++i]);
+        } else if (arg == "-n" && i + 1 < argc) {
+            config.noise = std::strtof(argv[++i], nullptr);
+        } else if (arg == "-D" && i + 2 < argc) {
+            config.dc_offset = { std::strtof(argv[i+1], nullptr), std::strtof(argv[i+2], nullptr) };
+            i += 2;
+        } else if (arg == "-i" && i + 1 < argc) {
+            config.tank_time_constant = std::strtof(argv[++i], nullptr);
+        } else if (arg == "-j" && i + 1 < argc) {
+            config.timing_jitter = std::strtof(argv[++i], nullptr);
+        } else if (arg == "-l" && i + 1 < argc) {
+            duration = std::strtod(argv[++i], nullptr);
+        } else if (arg == "-s" && i + 1 < argc) {
+            config.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "-u") {
+            cu8 = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "-T" && i + 1 < argc) {
+            rtl_tcp_port = std::atoi(argv[++i]);
+        } else if (arg == "-v") {
+            verbose = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [-t transponder]... [-r sps] [-n noise_dBFS] [-D i q] [-i tau] [-j jitter] [-l seconds] [-s seed] [-u] [-o file] [-T port] [-v]\n";
+            std::cerr << "\t-t spec     \t\tAdd a transponder: <opn|rc3|rc4>:<id>[,option...], options:\n";
+            std::cerr << "\t            \t\t  rssi=<dBFS> (-30), cfo=<Hz> (0), at=<s> (0.5), dur=<s> (0: always on),\n";
+            std::cerr << "\t            \t\t  interval=<ms> (1.5), status=<byte> (RC3), rc4=<hex payload>, sync (OpenStint)\n";
+            std::cerr << "\t-r sps      default:" << SAMPLES_PER_SYMBOL << "   \tSamples per symbol (2: 2.5 MSPS, 8: 10 MSPS)\n";
+            std::cerr << "\t-n dBFS     default:-45 \tNoise power (SNR = rssi - noise)\n";
+            std::cerr << "\t-D i q      default:0 0 \tDC offset (ADC units)\n";
+            std::cerr << "\t-i tau      default:0.3 \tLC-tank ringing time constant (symbols, ISI)\n";
+            std::cerr << "\t-j sigma    default:0.02\tSymbol timing jitter (symbols)\n";
+            std::cerr << "\t-l seconds  default:auto\tLength (default: until every transponder left the field)\n";
+            std::cerr << "\t-s seed     default:1   \tRandom seed\n";
+            std::cerr << "\t-u          default:off \tWrite CU8 (RTL-SDR) instead of CS8 (HackRF)\n";
+            std::cerr << "\t-o file     default:-   \tOutput file (default: stdout)\n";
+            std::cerr << "\t-T port     default:off \tServe the samples to a client as rtl_tcp would (CU8, paced), instead of writing them\n";
+            std::cerr << "\t-v          default:off \tPrint the generated frames (ground truth) to stderr\n";
+            return EXIT_FAILURE;
+        }
+    }
+    if (config.transponders.empty()) {
+        std::cerr << "No transponders given (-t)\n";
+        return EXIT_FAILURE;
+    }
+
+    bool always_on = false;
+    for (const auto& t : config.transponders) {
+        always_on |= (t.crossing_duration <= 0.0);
+    }
+    // a client is served until it disconnects if no length is given and some
+    // transponders never leave the field
+    if (rtl_tcp_port > 0) {
+        SignalGenerator generator(config);
+        const uint64_t total = (duration > 0.0) ? static_cast<uint64_t>(duration * generator.rate()) : UINT64_MAX;
+        const uint64_t written = serve_rtl_tcp(generator, static_cast<uint16_t>(rtl_tcp_port), total, duration <= 0.0 && !always_on, verbose);
+        std::cerr << "Served " << written << " samples (" << (written / generator.rate()) << " s)\n";
+        return written > 0 ? 0 : EXIT_FAILURE;
+    }
+    if (duration <= 0.0 && always_on) {
+        duration = 1.0;
+    }
+
+    std::FILE* out = stdout;
+    if (!output.empty() && output != "-") {
+        out = std::fopen(output.c_str(), "wb");
+        if (out == nullptr) {
+            std::cerr << "Failed to open '" << output << "'\n";
+            return EXIT_FAILURE;
+        }
+    }
+#ifdef _WIN32
+    else {
+        _setmode(_fileno(stdout), _O_BINARY);
+    }
+#endif
+
+    SignalGenerator generator(config);
+    const uint64_t total = (duration > 0.0) ? static_cast<uint64_t>(duration * generator.rate()) : UINT64_MAX;
+    std::vector<uint8_t> buffer(2 * CHUNK_SAMPLES);
+    uint64_t written = 0;
+    while (written < total && (duration > 0.0 || !generator.finished())) {
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(CHUNK_SAMPLES, total - written));
+        if (cu8) {
+            generator.generate_cu8(buffer.data(), n);
+        } else {
+            generator.generate_cs8(reinterpret_cast<std::complex<int8_t>*>(buffer.data()), n);
+        }
+        if (std::fwrite(buffer.data(), 2, n, out) != n) {
+            break; // closed pipe
+        }
+        written += n;
+
+        if (verbose) {
+            print_frames(generator);
+        }
+    }
+
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    std::cerr << "Generated " << written << " samples (" << (written / generator.rate()) << " s)\n";
+    return 0;
+}
@@ -1,249 +1,128 @@
 #include <atomic>
-#include <chrono>
-#include <complex>
 #include <csignal>
 #include <cstdint>
-#include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <string>
-#include <thread>
 #include <vector>
 
 #include "commons.hpp"
-#include "capture.hpp"
+#include "hackrf_source.hpp"
+#include "logger.hpp"
+#include "sample_source.hpp"
 
-#include <libhackrf/hackrf.h>
-
-
-static hackrf_device* device = nullptr;
 static std::atomic<bool> do_exit(false);
 
-static const uint64_t CENTER_FREQ_HZ       = 5000000ULL;
-static const uint32_t BB_FILTER_BW         = 1750000;
-static const uint8_t DEFAULT_LNA_GAIN      = 24;           // 0-40 in steps of 8 or so; experiment
-static const uint8_t DEFAULT_VGA_GAIN      = 20;           // 0-62
-
 // signal handler to break the capture loop
 void signal_handler(int signum) {
     std::cerr << "\nCaught signal " << signum << " — stopping...\n";
     do_exit = true;
 }
 
-// hackrf callback invoked for each block of data
-extern "C" int rx_callback(hackrf_transfer* transfer) {
-    if (do_exit) {
-        return 0;
-    }
-
-    uint32_t sample_count = transfer->valid_length / 2;
-    const std::complex<int8_t> *samples = reinterpret_cast<const std::complex<int8_t>*>(transfer->buffer);
-    
-    detect_frames(samples, sample_count);
-
-    // Returning 0 indicates "keep going".
-    return 0;
-}
-
-// capture replay callback (capture.cpp interface). hackrf_transfer captures
-// store signed int8 I/Q just like the live transfer buffer, so no conversion
-// is needed — we only reinterpret the raw bytes.
-void file_rx_callback(unsigned char* buf, uint32_t len, void* /*ctx*/) {
-    if (do_exit) {
-        return;
-    }
-
-    uint32_t sample_count = len / 2;
-    const std::complex<int8_t>* samples = reinterpret_cast<const std::complex<int8_t>*>(buf);
-
-    detect_frames(samples, sample_count);
-}
-
 int main(int argc, char** argv) {
-    int result = HACKRF_SUCCESS;
-    int streaming_status = HACKRF_TRUE;
-
-    const uint64_t freq_hz = CENTER_FREQ_HZ;
-    const uint32_t sample_rate = SAMPLE_RATE;
-    const uint32_t filter_bw = BB_FILTER_BW;
-    uint8_t lna_gain = DEFAULT_LNA_GAIN;
-    uint8_t vga_gain = DEFAULT_VGA_GAIN;
-    bool bias_tee = false;
-    bool amp_enable = false; // hackrf has a custom, +13 dB preamp
-    const char* hackrf_serial = nullptr;
-    std::vector<std::string> capture_files;
+    HackRFSettings settings;
+    SourceOptions sources_options;
 
     // process command line arguments
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
 
-        if (arg == "-d" && i + 1 < argc) {
-            hackrf_serial = argv[++i];
-        } else if (arg == "-l" && i + 1 < argc) {
-            lna_gain = std::atoi(argv[++i]);
-            lna_gain = (lna_gain / 8) * 8; // steps of 8
-            if (lna_gain > 40) {
+        if (arg == "-l" && i + 1 < argc) {
+            const int lna_gain = (std::atoi(argv[++i]) / 8) * 8; // steps of 8
+            if (lna_gain < 0 || lna_gain > 40) {
                 std::cerr << "Error: LNA gain must be between 0 and 40.\n";
                 return 1;
             }
+            settings.lna_gain = static_cast<uint8_t>(lna_gain);
         } else if (arg == "-v" && i + 1 < argc) {
-            vga_gain = std::atoi(argv[++i]);
-            vga_gain = (vga_gain / 2) * 2; // steps of 2
-            if (vga_gain > 62) {
+            const int vga_gain = (std::atoi(argv[++i]) / 2) * 2; // steps of 2
+            if (vga_gain < 0 || vga_gain > 62) {
                 std::cerr << "Error: VGA gain must be between 0 and 62.\n";
                 return 1;
             }
+            settings.vga_gain = static_cast<uint8_t>(vga_gain);
+        } else if (arg == "-R" && i + 1 < argc) {
+            sources_options.samples_per_symbol = std::atoi(argv[++i]);
+            if (!supported_samples_per_symbol(sources_options.samples_per_symbol)) {
+                std::cerr << "Error: samples per symbol must be 2, 4 or 8.\n";
+                return 1;
+            }
         } else if (arg == "-b") {
-            bias_tee = true;
+            settings.bias_tee = true;
         } else if (arg == "-a") {
-            amp_enable = true;
-        } else if (arg == "-c" && i + 1 < argc) {
-            capture_files.push_back(argv[++i]);
+            settings.amp_enable = true;
+        } else if (parse_source_arguments(i, argc, arg, argv, &sources_options)) {
+            // do nothing
         } else if (parse_common_arguments(i, argc, arg, argv)) {
             // do nothing
         } else {
             if (arg != "-h") {
                 std::cerr << "Unknown argument: " << arg << "\n";
             }
-            std::cerr << "Usage: " << argv[0] << " [-d ser_nr] [-l <0..40>] [-v <0..62>] [-a] [-b] [-c file.iq] [-p tcp_port] [-s dir] [-m] [-t]\n";
-            std::cerr << "\t-d ser_nr   default:first\tserial number of the desired HackRF\n";
-            std::cerr << "\t-l <0..40>  default:" << static_cast<int>(DEFAULT_LNA_GAIN) << "  \tLNA gain (rf signal amplifier; valid values: 0/8/16/24/32/40)\n";
-            std::cerr << "\t-v <0..62>  default:" << static_cast<int>(DEFAULT_LNA_GAIN) << "  \tVGA gain (baseband signal amplifier, steps of 2)\n";
+            std::cerr << "Usage: " << argv[0] << " [-d ser_nr[+ser_nr]]... [-l <0..40>] [-v <0..62>] [-a] [-b] [-R <2|4|8>] [-c file.iq] [-G spec]... [-x] [-p tcp_port] [-j tcp_port] [-J file] [-S name] [-s dir] [-m] [-f tcp_port] [-F file] [-M mask] [-q] [-t] [-r]\n";
+            std::cerr << "\t-d ser_nr   default:first\tserial number of the desired HackRF, or tcp://host[:port] of an rtl_tcp server (-R 2); repeat for more loops (tagged 0, 1, ...), join with + for antenna diversity\n";
+            std::cerr << "\t-l <0..40>  default:" << static_cast<int>(HackRFSettings().lna_gain) << "  \tLNA gain (rf signal amplifier; valid values: 0/8/16/24/32/40)\n";
+            std::cerr << "\t-v <0..62>  default:" << static_cast<int>(HackRFSettings().vga_gain) << "  \tVGA gain (baseband signal amplifier, steps of 2)\n";
             std::cerr << "\t-a          default:off \tEnable preamp (+13 dB to input RF signal)\n";
             std::cerr << "\t-b          default:off \tEnable bias-tee (+3.3 V, 50 mA max)\n";
-            std::cerr << "\t-c file.iq  default:off \tReplay a CS8 IQ capture (hackrf_transfer) instead of using the radio\n";
+            std::cerr << "\t-R <2|4|8>  default:" << SAMPLES_PER_SYMBOL << "   \tSamples per symbol (2: 2.5 MSPS, 8: 10 MSPS); also of -c and -G\n";
+            std::cerr << "\t-c file.iq  default:off \tReplay a CS8 IQ capture (hackrf_transfer; - for stdin) instead of using the radio\n";
+            std::cerr << "\t-G spec     default:off \tDecode synthetic transponders instead of the radio (see openstint_generator -t)\n";
+            std::cerr << "\t-x          default:off \tProcess the capture offline: as fast as possible, timestamps from the sample counter\n";
             std::cerr << "\t-p port     default:" << DEFAULT_ZEROMQ_PORT << "\tZeroMQ publisher port\n";
+            std::cerr << "\t-j port     default:" << DEFAULT_JOURNAL_PORT << "\tJournal catch-up endpoint port\n";
+            std::cerr << "\t-J file     default:off \tAppend every message to an on-disk journal\n";
+            std::cerr << "\t-S name     default:off \tPublish to a shared-memory ring (/dev/shm/<name>, Linux only)\n";
             std::cerr << "\t-m          default:off \tEnable monitor mode (print received frames to stdout)\n";
+            std::cerr << "\t-f port     default:off \tPublish binary frame records (topic \"F\") on this ZeroMQ port\n";
+            std::cerr << "\t-F file     default:off \tWrite binary frame records to a file\n";
+            std::cerr << "\t-M mask     default:0x3f\tFrame record fields (see docs/decoder-protocol.md)\n";
+            std::cerr << "\t-q          default:off \tQuiet mode (do not echo reports to stdout)\n";
             std::cerr << "\t-t          default:off \tUse system clock as the timebase (beware of NTP jumps)\n";
+            std::cerr << "\t-r          default:off \tCorrect the timebase for drift against OpenStint time-sync transponders\n";
             std::cerr << "\t-s dir      default:.   \tRC4 registry storage directory\n";
             
             return 1;
         }
     }
 
-    init_commons();
-
-    // install signal handlers
-    std::signal(SIGINT, signal_handler);
-    std::signal(SIGTERM, signal_handler);
-
-    // capture replay mode: skip radio init entirely and stream the file(s)
-    // through a dedicated file callback.
-    if (!capture_files.empty()) {
-        std::cout << "HackRF FILE RX: replaying " << capture_files.size()
-                  << " capture file(s), sample_rate=" << sample_rate << " Hz\n";
-        replay_capture(capture_files, sample_rate, file_rx_callback, nullptr, do_exit);
-        std::cerr << "Done.\n";
-        return 0;
+    if (offline_mode() && sources_options.capture_files.empty() && sources_options.generated.empty()) {
+        std::cerr << "Error: offline mode (-x) needs a capture file (-c) or synthetic transponders (-G).\n";
+        return 1;
     }
 
-    std::cout << "HackRF RX: freq=" << freq_hz << " Hz, sample_rate=" << sample_rate
-              << " Hz, LNA=" << (int)lna_gain << ", VGA=" << (int)vga_gain << "\n";
+    // the radio, rtl_tcp and the captures are all sampled at the rate of -R
+    const uint32_t sample_rate = SYMBOL_RATE * sources_options.samples_per_symbol;
+    settings.sample_rate = sample_rate;
+    RtlSettings rtl_tcp_settings;
+    rtl_tcp_settings.sample_rate = sample_rate;
 
-    // init lib
-    result = hackrf_init();
-    if (result != HACKRF_SUCCESS) {
-        std::fprintf(stderr, "hackrf_init() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-        return EXIT_FAILURE;
+    if (sources_options.capture_files.empty() && sources_options.generated.empty()) {
+        log_out("HackRF RX: freq={} Hz, sample_rate={} Hz, LNA={}, VGA={}", settings.freq_hz, settings.sample_rate, (int)settings.lna_gain, (int)settings.vga_gain);
     }
-
-    // open the first available device
-    result = hackrf_open_by_serial(hackrf_serial, &device);
-    if (result != HACKRF_SUCCESS || device == nullptr) {
-        std::fprintf(stderr, "hackrf_open() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-        hackrf_exit();
+    std::vector<size_t> loop_inputs;
+    std::vector<LoopSource> sources = create_sources(sources_options, SampleFormat::CS8, rtl_tcp_settings,
+        [&settings](const std::string& serial) { return make_hackrf_source(serial, settings); },
+        &loop_inputs);
+    if (sources.empty()) {
         return EXIT_FAILURE;
     }
 
-    read_partid_serialno_t serno;
-    result = hackrf_board_partid_serialno_read(device, &serno);
-    if (result != HACKRF_SUCCESS) {
-        fprintf(stderr, "hackrf_board_partid_serialno_read() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-    } else {
-        printf("HackRF SerNo.: %08x%08x%08x%08x\n", serno.serial_no[0], serno.serial_no[1], serno.serial_no[2], serno.serial_no[3]);
-    }
-
-    // set center frequency
-    result = hackrf_set_freq(device, freq_hz);
-    if (result != HACKRF_SUCCESS) {
-        std::fprintf(stderr, "hackrf_set_freq() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-        goto cleanup;
-    }
-
-    // set sample rate (Hz)
-    result = hackrf_set_sample_rate(device, sample_rate);
-    if (result != HACKRF_SUCCESS) {
-        std::fprintf(stderr, "hackrf_set_sample_rate() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-        goto cleanup;
-    }
-
-    // set filter BW (Hz)
-    result = hackrf_set_baseband_filter_bandwidth(device, filter_bw);
-    if (result != HACKRF_SUCCESS) {
-        std::fprintf(stderr, "hackrf_set_baseband_filter_bandwidth() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-        goto cleanup;
-    }
-
-    // set LNA gain
-    result = hackrf_set_lna_gain(device, lna_gain);
-    if (result != HACKRF_SUCCESS) {
-        std::fprintf(stderr, "hackrf_set_lna_gain() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-    }
+    init_commons(loop_inputs, sources_options.samples_per_symbol);
 
-    // set VGA gain
-    result = hackrf_set_vga_gain(device, vga_gain);
-    if (result != HACKRF_SUCCESS) {
-        std::fprintf(stderr, "hackrf_set_vga_gain() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-    }
-
-    // (Optional) enable amplified antenna
-    hackrf_set_amp_enable(device, amp_enable ? 1 : 0);
-    if (result != HACKRF_SUCCESS) {
-		std::fprintf(stderr, "hackrf_set_amp_enable() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-    }
-
-    // (Optional) enable bias-tee
-    result = hackrf_set_antenna_enable(device, bias_tee ? 1 : 0);
-    if (result != HACKRF_SUCCESS) {
-		std::fprintf(stderr, "hackrf_set_antenna_enable() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-    }
-
-    // start receiving (callback provides raw interleaved I/Q samples)
-    result = hackrf_start_rx(device, rx_callback, nullptr);
-    if (result != HACKRF_SUCCESS) {
-        std::fprintf(stderr, "hackrf_start_rx() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-        goto cleanup;
-    }
-
-    std::cerr << "Streaming... stop with Ctrl-C\n";
-
-    // main loop — exit when handler sets do_exit (Ctrl-C) or device stops
-    while (!do_exit && (streaming_status = hackrf_is_streaming(device)) == HACKRF_TRUE) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-        report_detections();
-    }
-    if (!do_exit && streaming_status != HACKRF_TRUE) {
-        std::fprintf(stderr, "hackrf_is_streaming() reported streaming stopped: %s (%d)\n",
-                     hackrf_error_name(static_cast<enum hackrf_error>(streaming_status)), streaming_status);
-    }
-
-    // stop RX
-    result = hackrf_stop_rx(device);
-    if (result != HACKRF_SUCCESS) {
-        std::fprintf(stderr, "hackrf_stop_rx() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-    }
+    // install signal handlers
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
 
-cleanup:
-    std::cout << "cleanup\n";
-    if (device != nullptr) {
-        result = hackrf_close(device);
-        if (result != HACKRF_SUCCESS) {
-            std::fprintf(stderr, "hackrf_close() failed: %s (%d)\n", hackrf_error_name(static_cast<enum hackrf_error>(result)), result);
-        }
+    bool ok = true;
+    if (offline_mode()) {
+        log_out("HackRF FILE RX: processing {} offline, sample_rate={} Hz", sources.front().source->name(), sample_rate);
+        stream_source_offline(*sources.front().source, sample_rate, do_exit);
+    } else {
+        ok = stream_sources(sources, do_exit);
     }
-    hackrf_exit();
+    sources.clear(); // stop and close the radios
 
-    std::cerr << "Done.\n";
-    return do_exit ? 0 : EXIT_FAILURE; // non-zero return code on non-regular exit
-}
\ No newline at end of file
+    log_err("Done.");
+    return ok ? 0 : EXIT_FAILURE; // non-zero return code on non-regular exit
+}
@@ -0,0 +1,203 @@
+// Parallel offline decoder for long captures.
+//
+// The capture is split into fixed-length segments, decoded concurrently, each
+// by a receiver of its own. A segment starts OFFLINE_WARMUP_SECONDS early, so
+// the detector's noise and DC estimates settle, and runs OFFLINE_TAIL_SYMBOLS
+// past its end, so a frame starting at the seam is read in full. A segment
+// keeps only the frames which start in its own range: every frame is decoded
+// by exactly one segment. The merged frames then go through a single
+// PassingDetector, in timecode order, like in the live decoder.
+//
+// The segments do not depend on the number of threads, and timestamps come
+// from the sample counter, so the output is the same for every run.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame.hpp"
+#include "transponder.hpp"
+#include "passing.hpp"
+#include "rc4.hpp"
+#include "receiver.hpp"
+#include "mapped_file.hpp"
+
+#define OFFLINE_SEGMENT_SECONDS 10
+#define OFFLINE_WARMUP_SECONDS 0.1
+#define OFFLINE_TAIL_SYMBOLS 256     // longer than any frame (preamble, payload, EQ context)
+#define OFFLINE_CHUNK_SAMPLES 16384  // same as a live buffer; noise statistics are per buffer
+#define OFFLINE_REPORT_US 100000ull  // passing detection cadence, as in the live loops
+
+using namespace std::chrono;
+
+struct Segment {
+    uint64_t begin; // owned range (samples)
+    uint64_t end;
+    std::vector<DecodedFrame> frames;
+    uint64_t frames_received = 0;
+};
+
+static uint64_t timecode_to_us(uint64_t timecode) {
+    return timecode * 1000000ull / SAMPLE_RATE;
+}
+
+static void decode_segment(const uint8_t* capture, uint64_t sample_count, bool cu8, Segment* segment) {
+    const uint64_t warmup = static_cast<uint64_t>(OFFLINE_WARMUP_SECONDS * SAMPLE_RATE);
+    const uint64_t first = (segment->begin > warmup) ? segment->begin - warmup : 0;
+    const uint64_t last = std::min<uint64_t>(sample_count, segment->end + OFFLINE_TAIL_SYMBOLS * SAMPLES_PER_SYMBOL);
+
+    SpsFrameReceiver<SAMPLES_PER_SYMBOL> receiver;
+    std::vector<std::complex<int8_t>> conversion_buffer(cu8 ? OFFLINE_CHUNK_SAMPLES : 0);
+    auto on_frame = [segment](Frame* frame) {
+        if (frame->timecode < segment->begin || frame->timecode >= segment->end) {
+            return; // belongs to the neighbouring segment
+        }
+        segment->frames_received++;
+        DecodedFrame decoded;
+        if (decode_frame(frame, &decoded)) {
+            segment->frames.push_back(decoded);
+        }
+    };
+
+    auto on_abort = [segment](const Frame* frame, FrameOutcome) {
+        if (frame->timecode >= segment->begin && frame->timecode < segment->end) {
+            segment->frames_received++;
+        }
+    };
+
+    for (uint64_t timecode = first; timecode < last; timecode += OFFLINE_CHUNK_SAMPLES) {
+        const size_t count = static_cast<size_t>(std::min<uint64_t>(OFFLINE_CHUNK_SAMPLES, last - timecode));
+        const uint8_t* raw = capture + 2 * timecode;
+        const std::complex<int8_t>* samples = reinterpret_cast<const std::complex<int8_t>*>(raw);
+        if (cu8) {
+            // RTL-SDR: unsigned, DC at 128
+            for (size_t i = 0; i < count; i++) {
+                conversion_buffer[i] = { static_cast<int8_t>(raw[2*i] - 128), static_cast<int8_t>(raw[2*i+1] - 128) };
+            }
+            samples = conversion_buffer.data();
+        }
+        receiver.process(samples, count, timecode, timecode_to_us(timecode), on_frame, on_abort);
+    }
+}
+
+static void report(PassingDetector& passing_detector, uint64_t now_ts) {
+    for (const auto& time_sync : passing_detector.identify_timesyncs(500000l)) {
+        std::printf("%s\n", std::format("T {} {} {} {}",
+            time_sync.timestamp / 1000ul,
+            transponder_system_name(time_sync.transponder_type),
+            time_sync.transponder_id,
+            time_sync.transponder_timestamp
+        ).c_str());
+    }
+    for (const auto& passing : passing_detector.identify_passings(now_ts > 250000ul ? (now_ts-250000ul) : 0ul)) {
+        std::printf("%s\n", std::format("P {} {} {} {:.2f} {} {}",
+            passing.timestamp / 1000ul,
+            transponder_system_name(passing.transponder_type),
+            passing.transponder_id,
+            passing.rssi,
+            passing.hits,
+            passing.duration
+        ).c_str());
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string capture_file;
+    bool cu8 = false;
+    unsigned thread_count = std::max(1u, std::thread::hardware_concurrency());
+    std::string storage_dir = ".";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-c" && i + 1 < argc) {
+            capture_file = argv[++i];
+        } else if (arg == "-u") {
+            cu8 = true;
+        } else if (arg == "-T" && i + 1 < argc) {
+            thread_count = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "-s" && i + 1 < argc) {
+            storage_dir = argv[++i];
+        } else {
+            if (arg != "-h") {
+                std::cerr << "Unknown argument: " << arg << "\n";
+            }
+            std::cerr << "Usage: " << argv[0] << " -c file.iq [-u] [-T threads] [-s dir]\n";
+            std::cerr << "\t-c file.iq  \t\t\tCapture to decode (CS8, hackrf_transfer), recorded at " << SAMPLE_RATE << " SPS\n";
+            std::cerr << "\t-u          default:off \tThe capture is CU8 (rtl_sdr)\n";
+            std::cerr << "\t-T threads  default:all \tDecoder threads\n";
+            std::cerr << "\t-s dir      default:.   \tRC4 registry storage directory\n";
+            return 1;
+        }
+    }
+    if (capture_file.empty()) {
+        std::cerr << "No capture file given (-c)\n";
+        return EXIT_FAILURE;
+    }
+
+    MappedFile capture;
+    if (!capture.open(capture_file)) {
+        std::cerr << "Failed to open '" << capture_file << "'\n";
+        return EXIT_FAILURE;
+    }
+    capture.advise_sequential();
+    const uint64_t sample_count = capture.size() / 2;
+
+    const auto start = steady_clock::now();
+
+    // fixed segment boundaries: the output does not depend on the thread count
+    const uint64_t segment_length = static_cast<uint64_t>(OFFLINE_SEGMENT_SECONDS) * SAMPLE_RATE;
+    std::vector<Segment> segments;
+    for (uint64_t begin = 0; begin < sample_count; begin += segment_length) {
+        segments.push_back({ begin, std::min(begin + segment_length, sample_count), {} });
+    }
+
+    std::atomic<size_t> next_segment = 0;
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < std::min<size_t>(thread_count, segments.size()); t++) {
+        workers.emplace_back([&] {
+            init_transponders();
+            for (size_t s = next_segment++; s < segments.size(); s = next_segment++) {
+                decode_segment(capture.data(), sample_count, cu8, &segments[s]);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // single pass over the merged frames, in timecode order
+    PassingDetector passing_detector(SAMPLE_RATE);
+    RC4FileBasedRegistry rc4_registry(storage_dir);
+    rc4_registry.resync();
+    DetectionRouter router(passing_detector, rc4_registry, nullptr);
+
+    uint64_t frames_received = 0, frames_decoded = 0;
+    uint64_t next_report = OFFLINE_REPORT_US;
+    for (const Segment& segment : segments) {
+        frames_received += segment.frames_received;
+        for (const DecodedFrame& frame : segment.frames) {
+            while (frame.timestamp >= next_report) {
+                report(passing_detector, next_report);
+                next_report += OFFLINE_REPORT_US;
+            }
+            frames_decoded += router.route(frame);
+        }
+    }
+    report(passing_detector, UINT64_MAX); // flush the passings in progress
+
+    const double elapsed = duration<double>(steady_clock::now() - start).count();
+    const double length = static_cast<double>(sample_count) / SAMPLE_RATE;
+    std::fprintf(stderr, "Decoded %.1f s of samples in %.1f s (%.0fx real time, %zu segments, %zu threads), %llu/%llu frames\n",
+        length, elapsed, length / elapsed, segments.size(), workers.size(),
+        static_cast<unsigned long long>(frames_decoded), static_cast<unsigned long long>(frames_received));
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path, bool _writable) {
+    close();
+    writable = _writable;
+
+    HANDLE file = CreateFileA(
+        path.c_str(),
+        writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr,
+        writable ? OPEN_ALWAYS : OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    file_handle = file;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(file_size.QuadPart);
+    if (!map()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::map() {
+    if (length == 0) {
+        return true; // an empty file can not be mapped, but it is valid
+    }
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle == nullptr) {
+        return false;
+    }
+    ptr = static_cast<uint8_t*>(MapViewOfFile(mapping_handle, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, length));
+    return ptr != nullptr;
+}
+
+void MappedFile::unmap() {
+    if (ptr != nullptr) {
+        UnmapViewOfFile(ptr);
+        ptr = nullptr;
+    }
+    if (mapping_handle != nullptr) {
+        CloseHandle(mapping_handle);
+        mapping_handle = nullptr;
+    }
+}
+
+bool MappedFile::resize(size_t size) {
+    if (!writable || file_handle == nullptr) {
+        return false;
+    }
+    unmap();
+    LARGE_INTEGER new_size;
+    new_size.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFilePointerEx(file_handle, new_size, nullptr, FILE_BEGIN) || !SetEndOfFile(file_handle)) {
+        map(); // keep the old mapping usable
+        return false;
+    }
+    length = size;
+    return map();
+}
+
+void MappedFile::close() {
+    unmap();
+    if (file_handle != nullptr) {
+        CloseHandle(file_handle);
+        file_handle = nullptr;
+    }
+    length = 0;
+}
+
+bool MappedFile::is_open() const {
+    return file_handle != nullptr;
+}
+
+void MappedFile::advise_sequential() {
+    // no equivalent for mapped views; the cache manager detects sequential access
+}
+
+#else
+
+bool MappedFile::open(const std::string& path, bool _writable) {
+    close();
+    writable = _writable;
+
+    fd = writable ? ::open(path.c_str(), O_RDWR | O_CREAT, 0644) : ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (!map()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::map() {
+    if (length == 0) {
+        return true; // an empty file can not be mapped, but it is valid
+    }
+    void* p = mmap(nullptr, length, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    ptr = static_cast<uint8_t*>(p);
+    return true;
+}
+
+void MappedFile::unmap() {
+    if (ptr != nullptr) {
+        munmap(ptr, length);
+        ptr = nullptr;
+    }
+}
+
+bool MappedFile::resize(size_t size) {
+    if (!writable || fd < 0) {
+        return false;
+    }
+    unmap();
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        map(); // keep the old mapping usable
+        return false;
+    }
+    length = size;
+    return map();
+}
+
+void MappedFile::close() {
+    unmap();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    length = 0;
+}
+
+bool MappedFile::is_open() const {
+    return fd >= 0;
+}
+
+void MappedFile::advise_sequential() {
+    if (ptr != nullptr) {
+        madvise(ptr, length, MADV_SEQUENTIAL);
+    }
+}
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Memory-mapped file, read-only or writable. Writable files can be grown (or
+// shrunk) with resize(), which remaps the file; previously returned data()
+// pointers are invalidated by that call.
+class MappedFile {
+    uint8_t* ptr = nullptr;
+    size_t length = 0;
+    bool writable = false;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    bool map();
+    void unmap();
+
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // opens an existing file read-only, or creates/opens a file for writing
+    bool open(const std::string& path, bool writable = false);
+    bool resize(size_t size);
+    void close();
+    // hint that the mapping is read front to back (aggressive read-ahead)
+    void advise_sequential();
+
+    bool is_open() const;
+    uint8_t* data() { return ptr; }
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return length; }
+};
@@ -17,8 +17,8 @@ static const std::vector<float> smoothing_fir = {
     0.01320163f, 0.00000000f
 };
 
-uint64_t timecode_to_usec(uint64_t timecode) {
-    return timecode * 1000000ull / SAMPLE_RATE;
+uint64_t timecode_to_usec(uint64_t timecode, uint32_t sample_rate) {
+    return timecode * 1000000ull / sample_rate;
 }
 
 TransponderSystem transponder_system(TransponderProtocol ttype) {
@@ -42,10 +42,9 @@ std::string transponder_system_name(TransponderSystem tsys) {
     return "OPN"; // silence warning
 }
 
-void PassingDetector::append(const Frame* frame, uint32_t transponder_id) {
-    TransponderKey transponder_key = std::make_pair(transponder_system(frame->transponder_protocol), transponder_id);
-    Detection d(frame->timestamp, frame->timecode, frame->rssi());
-    
+PassingDetector::PassingDetector(uint32_t _sample_rate) : sample_rate(_sample_rate) {}
+
+void PassingDetector::append(TransponderKey transponder_key, Detection d) {
     std::lock_guard<std::mutex> lock(mutex);
     detections[transponder_key].push_back(std::move(d));
     if (detections[transponder_key].size() > TRANSPONDER_DETECTION_MSG_LIMIT) {
@@ -56,12 +55,17 @@ void PassingDetector::append(const Frame* frame, uint32_t transponder_id) {
     }
 }
 
-void PassingDetector::timesync(const Frame* frame, uint32_t transponder_timestamp) {
-    TimeSyncMsg ts(frame->timestamp, transponder_timestamp);
+void PassingDetector::timesync(uint64_t timestamp, uint32_t transponder_timestamp) {
+    TimeSyncMsg ts(timestamp, transponder_timestamp);
     std::lock_guard<std::mutex> lock(mutex);
     timesync_messages.push_back(std::move(ts));
 }
 
+void PassingDetector::gap(uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(mutex);
+    gaps.push_back(timestamp);
+}
+
 // Linear interpolation similar to numpy.interp()
 // x_new: output sample points (must be sorted)
 // x: input sample points (must be sorted, increasing)
@@ -195,14 +199,8 @@ std::vector<Peak> find_peaks(const std::vector<float>& y, float min_prominence =
     return result;
 }
 
-struct PassingPoint {
-    uint64_t weighted_timestamp;
-    float max_rssi;
-    uint64_t duration;
-};
-
 // Calculate RSSI-weighted average timestamp for detections
-PassingPoint weigthed_passing(const std::deque<Detection>& detections, float max_rssi) {
+PassingPoint weigthed_passing(const std::deque<Detection>& detections, float max_rssi, uint32_t sample_rate) {
     float rssi_threshold = max_rssi - 6.0f;
 
     float weighted_sum = 0.0f;
@@ -222,7 +220,7 @@ PassingPoint weigthed_passing(const std::deque<Detection>& detections, float max
     }
 
     uint64_t timecode_average = static_cast<uint64_t>(weighted_sum / weight_total);
-    uint64_t weighted_timestamp = detections.front().timestamp + timecode_to_usec(timecode_average);
+    uint64_t weighted_timestamp = detections.front().timestamp + timecode_to_usec(timecode_average, sample_rate);
     return {weighted_timestamp, max_rssi, 0};
 }
 
@@ -284,7 +282,7 @@ float last_crossing(const std::vector<float>& data, float v) {
     return static_cast<float>(k);
 }
 
-PassingPoint compute_passing_point(const std::deque<Detection>& detections) {
+PassingPoint compute_passing_point(const std::deque<Detection>& detections, uint32_t sample_rate) {
     // Find the maximum RSSI
     const auto max_it = std::max_element(
         detections.begin(),
@@ -297,7 +295,7 @@ PassingPoint compute_passing_point(const std::deque<Detection>& detections) {
     // if just a few hits were received, do a weighted average of
     // peak points to find the passing point
     if (detections.size() < 16) {
-        return weigthed_passing(detections, max_rssi);
+        return weigthed_passing(detections, max_rssi, sample_rate);
     }
 
     // there are enough datapoints to pattern match on the waveform; first resample to a uniform timegrid
@@ -310,11 +308,11 @@ PassingPoint compute_passing_point(const std::deque<Detection>& detections) {
     if (rssi_dips.size() == 3) {
         auto pass_duration = static_cast<uint64_t>(rssi_dips[2].index - rssi_dips[0].index) * tc_duration / 128ul;
         auto pass_center_offset = static_cast<uint64_t>(rssi_dips[0].index) * tc_duration / 128ul + pass_duration/2;
-        auto pass_timestamp = detections.front().timestamp + timecode_to_usec(pass_center_offset);
+        auto pass_timestamp = detections.front().timestamp + timecode_to_usec(pass_center_offset, sample_rate);
         return {
             pass_timestamp,
             max_rssi,
-            timecode_to_usec(pass_duration)
+            timecode_to_usec(pass_duration, sample_rate)
         };
     }
     // no dual dips were detected, try find double peaks on a smoothed transition waveform
@@ -323,11 +321,11 @@ PassingPoint compute_passing_point(const std::deque<Detection>& detections) {
     if (rssi_peaks.size() == 2) {
         auto pass_duration = static_cast<uint64_t>(rssi_peaks[1].index - rssi_peaks[0].index) * tc_duration / 128ul;
         auto pass_center_offset = static_cast<uint64_t>(rssi_peaks[0].index) * tc_duration / 128ul + pass_duration/2;
-        auto pass_timestamp = detections.front().timestamp + timecode_to_usec(pass_center_offset);
+        auto pass_timestamp = detections.front().timestamp + timecode_to_usec(pass_center_offset, sample_rate);
         return {
             pass_timestamp,
             max_rssi,
-            timecode_to_usec(pass_duration)
+            timecode_to_usec(pass_duration, sample_rate)
         };
     }
     // fall back to default:
@@ -338,20 +336,23 @@ PassingPoint compute_passing_point(const std::deque<Detection>& detections) {
     float idx_last = last_crossing(y_smoothed, max_smoothed-6.0f);
     float pass_width = idx_last-idx_first;
     auto pass_center_offset = static_cast<uint64_t>((idx_first + pass_width/2.0f) / 128.0f * tc_duration);
-    auto pass_timestamp = detections.front().timestamp + timecode_to_usec(pass_center_offset);
+    auto pass_timestamp = detections.front().timestamp + timecode_to_usec(pass_center_offset, sample_rate);
 
     return {pass_timestamp, max_rssi, 0};
 }
 
-Passing create_passing(TransponderKey transponder_key, const std::deque<Detection>& detections) {
-    PassingPoint stats = compute_passing_point(detections);
+Passing create_passing(TransponderKey transponder_key, const std::deque<Detection>& detections, const std::vector<uint64_t>& gaps, uint32_t sample_rate) {
+    PassingPoint stats = compute_passing_point(detections, sample_rate);
     Passing p = {
         .timestamp = stats.weighted_timestamp,
         .transponder_type = transponder_key.first,
         .transponder_id = transponder_key.second,
         .rssi = stats.max_rssi,
         .hits = detections.size(),
-        .duration = stats.duration
+        .duration = stats.duration,
+        .gap = std::any_of(gaps.begin(), gaps.end(), [&detections](uint64_t gap) {
+            return detections.front().timestamp <= gap && gap <= detections.back().timestamp;
+        })
     };
     return p;
 }
@@ -364,7 +365,7 @@ std::vector<Passing> PassingDetector::identify_passings(uint64_t deadline) {
     std::vector<TransponderKey> erasable_entries;
     for (const auto& [transponder_key, detections] : detections) {
         if (!detections.empty() && detections.back().timestamp <= deadline) {
-            Passing p = create_passing(transponder_key, detections);
+            Passing p = create_passing(transponder_key, detections, gaps, sample_rate);
             erasable_entries.push_back(transponder_key);
             if (p.hits >= REPORT_HIT_LIMIT) {
                 passings.push_back(std::move(p));
@@ -377,6 +378,15 @@ std::vector<Passing> PassingDetector::identify_passings(uint64_t deadline) {
         detections.erase(key);
     }
 
+    // gaps before the pending detections can not affect any passing
+    uint64_t oldest = UINT64_MAX;
+    for (const auto& [transponder_key, detection_vec] : detections) {
+        if (!detection_vec.empty()) {
+            oldest = std::min(oldest, detection_vec.front().timestamp);
+        }
+    }
+    std::erase_if(gaps, [oldest, deadline](uint64_t gap) { return gap < oldest && gap <= deadline; });
+
     return passings;
 }
 
@@ -416,15 +426,22 @@ std::vector<TimeSync> PassingDetector::identify_timesyncs(uint64_t margin) {
     return timesyncs;
 }
 
-std::vector<uint32_t> PassingDetector::passings_between(TransponderSystem tsys, uint64_t from, uint64_t until) {
+std::vector<uint32_t> PassingDetector::passings_between(TransponderSystem tsys, uint64_t from, uint64_t until, float rssi_low, float rssi_high) {
     std::lock_guard<std::mutex> lock(mutex);
     std::vector<uint32_t> transponders;
     for (const auto& [transponder_key, detection_vec] : detections) {
-        if (detection_vec.empty()) { continue; }
-        if (transponder_key.first == tsys &&
-            detection_vec.front().timestamp <= until &&
-            detection_vec.back().timestamp >= from) {
-                transponders.push_back(transponder_key.second);
+        if (transponder_key.first != tsys) { continue; }
+        size_t in_range = 0;
+        size_t in_band = 0;
+        for (const auto& detection : detection_vec) {
+            if (detection.timestamp < from || detection.timestamp > until) { continue; }
+            in_range++;
+            if (detection.rssi >= rssi_low && detection.rssi <= rssi_high) {
+                in_band++;
+            }
+        }
+        if (in_band > 0 && in_band * 2 >= in_range) {
+            transponders.push_back(transponder_key.second);
         }
     }
     return transponders;
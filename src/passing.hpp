@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cmath>
 #include <cstdlib>
 
 #include <mutex>
@@ -18,6 +19,7 @@ enum class TransponderSystem {
     AMB         // rc3 and rc4 transponders
 };
 
+TransponderSystem transponder_system(TransponderProtocol ttype);
 std::string transponder_system_name(TransponderSystem tsys);
 
 struct Detection {
@@ -42,6 +44,7 @@ struct Passing {
     float rssi;
     size_t hits;
     uint64_t duration;
+    bool gap = false; // samples were lost between the first and the last detection
 };
 
 struct TimeSync {
@@ -53,15 +56,34 @@ struct TimeSync {
 
 typedef std::pair<TransponderSystem, uint32_t> TransponderKey;
 
+struct PassingPoint {
+    uint64_t weighted_timestamp;
+    float max_rssi;
+    uint64_t duration;
+};
+
+// estimate the moment of passing from the detections of a single transponder
+// (timecodes counted at <sample_rate>)
+PassingPoint compute_passing_point(const std::deque<Detection>& detections, uint32_t sample_rate);
+
 class PassingDetector {
+    const uint32_t sample_rate; // of the detections' timecodes
     std::map<TransponderKey, std::deque<Detection>> detections;
     std::vector<TimeSyncMsg> timesync_messages;
+    std::vector<uint64_t> gaps; // timestamps of lost samples
     std::mutex mutex;
 
 public:
-    void append(const Frame* frame, uint32_t transponder_id);
-    void timesync(const Frame* frame, uint32_t transponder_timestamp);
+    explicit PassingDetector(uint32_t sample_rate);
+
+    void append(TransponderKey transponder_key, Detection detection);
+    void timesync(uint64_t timestamp, uint32_t transponder_timestamp);
+    // samples were lost at <timestamp>; passings spanning it are marked
+    void gap(uint64_t timestamp);
     std::vector<TimeSync> identify_timesyncs(uint64_t margin);
     std::vector<Passing> identify_passings(uint64_t deadline);
-    std::vector<uint32_t> passings_between(TransponderSystem tsys, uint64_t timestamp_from, uint64_t timestamp_until);
+    // transponders detected between the two timestamps, most of the time
+    // within the RSSI range
+    std::vector<uint32_t> passings_between(TransponderSystem tsys, uint64_t timestamp_from, uint64_t timestamp_until,
+        float rssi_low = -INFINITY, float rssi_high = INFINITY);
 };
\ No newline at end of file
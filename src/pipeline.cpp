@@ -0,0 +1,175 @@
+#include "pipeline.hpp"
+
+#include <chrono>
+
+using namespace std::chrono;
+
+DecoderPipeline::DecoderPipeline(EventSink& _sink, RC4Registry& _rc4_registry, PipelineClock _clock, size_t input_count,
+                                 int samples_per_symbol)
+    : sink(_sink),
+      rc4_registry(_rc4_registry),
+      clock(_clock),
+      rate(SYMBOL_RATE * samples_per_symbol),
+      passing_detector(rate),
+      detection_router(passing_detector, rc4_registry, &rc4_trainer) {
+    for (size_t i = 0; i < input_count; i++) {
+        inputs.push_back(std::make_unique<Input>(samples_per_symbol, rate));
+    }
+    if (input_count > 1) {
+        diversity_combiner = std::make_unique<DiversityCombiner>(input_count, rate);
+    }
+}
+
+uint64_t DecoderPipeline::now() const {
+    if (clock.virtual_time) {
+        return samples() * 1000000ull / rate;
+    }
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count() - clock.epoch;
+}
+
+bool DecoderPipeline::process_frame(Frame* frame, size_t input) {
+    DecodedFrame decoded_frame;
+    bool decoded = decode_frame(frame, &decoded_frame);
+    if (decoded && diversity_combiner) {
+        // routed in report(), once the other inputs had their say
+        std::lock_guard<std::mutex> lock(diversity_mutex);
+        diversity_combiner->push(input, decoded_frame);
+    } else if (decoded) {
+        decoded = detection_router.route(decoded_frame);
+    }
+
+    // softbits is null if the preamble was not found
+    const FrameOutcome outcome = !frame->bits() ? FrameOutcome::NO_SYNC
+        : decoded ? FrameOutcome::DECODED : FrameOutcome::REJECTED;
+    sink.on_frame(*frame, outcome);
+    adapt_thresholds(*inputs[input], frame, outcome);
+    return decoded;
+}
+
+void DecoderPipeline::abort_frame(const Frame* frame, FrameOutcome outcome, size_t input) {
+    // a frame given up before its preamble was confirmed is a false trigger
+    rx_stats.register_abort();
+    adapt_thresholds(*inputs[input], frame, outcome);
+}
+
+void DecoderPipeline::adapt_thresholds(Input& in, const Frame* frame, FrameOutcome outcome) {
+    // false triggers tune the preamble search of the input
+    if (in.threshold_controller.feedback(frame->transponder_protocol, outcome, frame->timestamp)) {
+        for (TransponderProtocol protocol : { TransponderProtocol::OpenStint, TransponderProtocol::RC3, TransponderProtocol::RC4 }) {
+            in.frame_receiver->set_preamble_threshold(protocol, in.threshold_controller.threshold(protocol));
+        }
+    }
+}
+
+void DecoderPipeline::process(const std::complex<int8_t>* samples, size_t sample_count, size_t input) {
+    Input& in = *inputs[input];
+    uint64_t timecode = in.timecode;
+    uint64_t timestamp;
+    if (clock.virtual_time) {
+        timestamp = now();
+    } else {
+        // the buffer is complete when it gets here: now() is its last sample,
+        // plus the scheduler's jitter, which the model filters out
+        const uint64_t host_time = now();
+        const uint64_t lost = in.sample_clock.missing_samples(timecode + sample_count, host_time, sample_count);
+        if (lost > 0) {
+            // a transfer went missing upstream, before the first of the buffers
+            // confirming it; keep the counter in step with the radio, and flag
+            // the passings around it
+            const uint64_t suspect = SAMPLE_CLOCK_GAP_CONFIRM * sample_count;
+            passing_detector.gap(in.sample_clock.timestamp(timecode > suspect ? timecode - suspect : 0));
+            rx_stats.register_drop(lost);
+            in.timecode += lost;
+            timecode += lost;
+        }
+        in.sample_clock.update(timecode + sample_count, host_time);
+        timestamp = in.sample_clock.timestamp(timecode);
+    }
+    if (diversity_combiner) {
+        std::lock_guard<std::mutex> lock(diversity_mutex);
+        diversity_combiner->align(input, timecode, timestamp);
+    }
+
+    const bool idle = in.frame_receiver->process(samples, sample_count, timecode, timestamp, [this, input](Frame* frame) {
+        bool frame_processed = process_frame(frame, input);
+        rx_stats.register_frame(frame_processed);
+    }, [this, input](const Frame* frame, FrameOutcome outcome) {
+        abort_frame(frame, outcome, input);
+    });
+    if (idle && input == 0) {
+        rx_stats.save_channel_characteristics(
+            in.frame_receiver->dc_offset(),
+            in.frame_receiver->noise_energy()
+        );
+    }
+
+    // update sample counter
+    in.timecode += sample_count;
+}
+
+void DecoderPipeline::skip(size_t sample_count) {
+    for (auto& in : inputs) {
+        in->timecode += sample_count;
+    }
+}
+
+void DecoderPipeline::report() {
+    const uint64_t now_ts = now();
+
+    if (diversity_combiner) {
+        std::lock_guard<std::mutex> lock(diversity_mutex);
+        for (const DecodedFrame& frame : diversity_combiner->release(now_ts > DIVERSITY_HOLD_US ? now_ts - DIVERSITY_HOLD_US : 0)) {
+            detection_router.route(frame);
+        }
+    }
+
+    // report status once in a while
+    if (rx_stats.reporting_due(now_ts)) {
+        RxStatus status = rx_stats.status();
+        if (!clock.virtual_time) {
+            status.clock_ppm = inputs.front()->sample_clock.ppm();
+            status.clock_jitter = inputs.front()->sample_clock.jitter();
+        }
+        for (int i=0; i<3; i++) {
+            status.preamble_thresholds[i] = inputs.front()->threshold_controller.threshold(static_cast<TransponderProtocol>(i));
+        }
+        sink.on_status(now_ts, status);
+        rx_stats.reset(now_ts);
+    }
+
+    for (const auto& time_sync : passing_detector.identify_timesyncs(500000l)) {
+        sink.on_timesync(time_sync);
+    }
+
+    for (const auto& passing : passing_detector.identify_passings(now_ts > 250000ul ? (now_ts-250000ul) : 0ul)) {
+        sink.on_passing(passing);
+    }
+
+    for (auto& training : rc4_trainer.evaluate(now_ts)) {
+        LearningEvent event;
+        event.result = training.result;
+        event.session = training.session;
+        switch (training.result) {
+            case RC4Trainer::EvaluationResult::START:
+            event.rssi = training.rssi;
+            break;
+            case RC4Trainer::EvaluationResult::DONE: {
+                uint32_t transponder_id = training.preferred_transponder_id;
+                // RC4 hybrids: the RC3 id heard at the session's RSSI
+                auto detected_transponders = passing_detector.passings_between(TransponderSystem::AMB,
+                    training.timestamp_from, training.timestamp_until, training.rssi_low, training.rssi_high);
+                if (transponder_id == 0 && detected_transponders.size() == 1) {
+                    transponder_id = detected_transponders.front();
+                }
+                event.transponder_id = rc4_registry.store(transponder_id, training.payloads);
+                event.payload_count = training.payloads.size();
+            }
+            break;
+            case RC4Trainer::EvaluationResult::INTERRUPED:
+            case RC4Trainer::EvaluationResult::RESET:
+            case RC4Trainer::EvaluationResult::NO_ACTION:
+            break;
+        }
+        sink.on_learning(now_ts, event);
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "frame.hpp"
+#include "counters.hpp"
+#include "diversity.hpp"
+#include "passing.hpp"
+#include "rc4.hpp"
+#include "receiver.hpp"
+#include "sample_clock.hpp"
+#include "threshold_control.hpp"
+
+// RC4 learning progress ("L" messages)
+struct LearningEvent {
+    RC4Trainer::EvaluationResult result; // START, INTERRUPED, DONE or RESET
+    uint32_t session = 0;                // training session, numbered from 1
+    float rssi = 0.0f;                   // START: RSSI of the transponder on the loop
+    uint32_t transponder_id = 0;         // DONE: id the payloads were stored with
+    size_t payload_count = 0;            // DONE
+};
+
+// Outputs of a DecoderPipeline. Timestamps are in us, on the pipeline's clock.
+// on_frame() is called from the thread feeding the samples (process()), the
+// rest from the one calling report().
+class EventSink {
+public:
+    virtual ~EventSink() = default;
+    virtual void on_frame(const Frame&, FrameOutcome) {}
+    virtual void on_status(uint64_t /*timestamp*/, const RxStatus&) {}
+    virtual void on_timesync(const TimeSync&) {}
+    virtual void on_passing(const Passing&) {}
+    virtual void on_learning(uint64_t /*timestamp*/, const LearningEvent&) {}
+};
+
+// Timebase of a pipeline: us since <epoch> on the steady clock, or derived
+// from the sample counter (offline processing, deterministic).
+struct PipelineClock {
+    bool virtual_time = false;
+    uint64_t epoch = 0; // steady clock, us
+};
+
+// The decoder: sample chunks in, events out. A pipeline has no global state,
+// so a process can run any number of them, ie. one per radio, each on a
+// thread of its own. process() and report() may run on different threads.
+// The RC4 registry may be shared between pipelines.
+//
+// A pipeline may have more inputs on the same loop (antenna diversity), each
+// fed from a thread of its own. Their frames are combined before passing
+// detection, which delays them by DIVERSITY_HOLD_US. The sample counter and
+// the noise/DC/clock statistics and the preamble thresholds are the ones of
+// input 0.
+//
+// The samples come at <samples_per_symbol> (see supported_samples_per_symbol()),
+// all the inputs of a pipeline at the same rate.
+class DecoderPipeline {
+    struct Input {
+        std::unique_ptr<FrameReceiver> frame_receiver;
+        SampleClock sample_clock; // timestamps (live)
+        ThresholdController threshold_controller; // of frame_receiver's preamble search
+        std::atomic<uint64_t> timecode = 0; // sample counter
+
+        Input(int samples_per_symbol, uint32_t sample_rate)
+            : frame_receiver(make_frame_receiver(samples_per_symbol)), sample_clock(sample_rate) {}
+    };
+
+    EventSink& sink;
+    RC4Registry& rc4_registry;
+    const PipelineClock clock;
+    const uint32_t rate; // samples per second
+    std::vector<std::unique_ptr<Input>> inputs;
+
+    PassingDetector passing_detector;
+    RxStatistics rx_stats;
+    RC4Trainer rc4_trainer;
+    DetectionRouter detection_router;
+    std::unique_ptr<DiversityCombiner> diversity_combiner; // more inputs only
+    std::mutex diversity_mutex;
+
+    bool process_frame(Frame* frame, size_t input);
+    void abort_frame(const Frame* frame, FrameOutcome outcome, size_t input);
+    void adapt_thresholds(Input& in, const Frame* frame, FrameOutcome outcome);
+
+public:
+    DecoderPipeline(EventSink& sink, RC4Registry& rc4_registry, PipelineClock clock, size_t input_count = 1,
+                    int samples_per_symbol = SAMPLES_PER_SYMBOL);
+    // holds references to its own members
+    DecoderPipeline(const DecoderPipeline&) = delete;
+    DecoderPipeline& operator=(const DecoderPipeline&) = delete;
+
+    // next chunk of samples of an input
+    void process(const std::complex<int8_t>* samples, size_t sample_count, size_t input = 0);
+    // advance the sample counters without processing (ie. to let passings time out offline)
+    void skip(size_t sample_count);
+    // status, timesyncs, passings and RC4 learning that are due; call periodically
+    void report();
+
+    uint64_t now() const;
+    uint32_t sample_rate() const { return rate; }
+    uint64_t samples() const { return inputs.front()->timecode.load(std::memory_order_relaxed); }
+};
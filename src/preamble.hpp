@@ -13,12 +13,11 @@ class Preamble {
 
     static constexpr int bit_count = sizeof(T) * 8;
     int16_t pattern[bit_count][bit_count];
-    float threshold;
 
     friend struct CircBuff<T>;
 
 public:
-    constexpr Preamble(T preamble, float _threshold) noexcept : threshold(_threshold) {
+    constexpr Preamble(T preamble) noexcept {
         // Fill the 0th row with ±1 according to bits
         T mask = 1 << (bit_count - 1);
         for (int i=0; i<bit_count; ++i) {
@@ -76,7 +75,7 @@ public:
         buff[phase] = 0;
     }
     
-    bool match_preamble(const Preamble<T> &sync_word) {
+    bool match_preamble(const Preamble<T> &sync_word, float threshold) {
         // run matched filter against differential signal
         int32_t corr = sync_word.dot(buff, phase);
         
@@ -91,7 +90,7 @@ public:
 
         // create a statistics that can predict how well
         // the pattern fits to the sample.
-        return static_cast<float>(corr*corr) > sync_word.threshold * static_cast<float>(window_energy);
+        return static_cast<float>(corr*corr) > threshold * static_cast<float>(window_energy);
     }
 
     // re-calculate match metric, no compute cost spared
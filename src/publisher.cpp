@@ -0,0 +1,36 @@
+#include "publisher.hpp"
+
+
+Publisher::Publisher(const std::string& address)
+    : context(1), socket(context, zmq::socket_type::xpub) {
+    socket.bind(address);
+}
+
+void Publisher::poll_subscriptions() {
+    zmq::message_t msg;
+    while (socket.recv(msg, zmq::recv_flags::dontwait)) {
+        // subscription messages: 0x01 (subscribe) or 0x00 (unsubscribe), then the prefix
+        if (msg.size() == 0) { continue; }
+        const std::string_view data = msg.to_string_view();
+        std::string prefix(data.substr(1));
+        if (data[0] == 1) {
+            subscriptions.insert(std::move(prefix));
+        } else if (data[0] == 0) {
+            subscriptions.erase(prefix);
+        }
+    }
+}
+
+bool Publisher::is_subscribed(char topic) const {
+    for (const auto& prefix : subscriptions) {
+        // an empty prefix subscribes to everything
+        if (prefix.empty() || prefix.front() == topic) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Publisher::send(std::string_view message) {
+    socket.send(zmq::buffer(message), zmq::send_flags::none);
+}
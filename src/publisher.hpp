@@ -0,0 +1,32 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <string_view>
+
+#include <zmq.hpp>
+
+// ZeroMQ publisher that keeps track of what the clients are subscribed to.
+//
+// Every message is identified by its first character (its topic, ie. "P" for
+// passings, "T" for timesyncs). The underlying XPUB socket reports subscription
+// changes; by default only the first subscription and the last unsubscription
+// of a given prefix is passed up, so a plain set of prefixes is enough to know
+// if anyone is listening. This allows skipping message formatting altogether.
+class Publisher {
+    zmq::context_t context;
+    zmq::socket_t socket;
+    std::set<std::string> subscriptions;
+
+public:
+    explicit Publisher(const std::string& address);
+    // manages a zmq socket; not thread-safe, use from a single thread only
+    Publisher(const Publisher&) = delete;
+    Publisher& operator=(const Publisher&) = delete;
+
+    // drain pending (un)subscription notifications; non-blocking
+    void poll_subscriptions();
+    // true if a message starting with the topic character reaches any client
+    bool is_subscribed(char topic) const;
+    void send(std::string_view message);
+};
@@ -2,13 +2,82 @@
 
 #include <algorithm>
 #include <bit>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <set>
 #include <string>
+#include <thread>
+
+#include "logger.hpp"
+#include "mapped_file.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 #define RC4_TRAINING_RSSI_LIMIT -20.0f
+#define RC4_SESSION_RSSI_DB 1.5f        // frames this close to a session's RSSI belong to it
+#define RC4_SESSION_CENTER_AVERAGING 8  // frames, until training starts
+#define RC4_SESSION_IDLE_US 1000000     // clusters not heard of for 1 s are dropped
+#define RC4_MAX_SESSIONS 8
+#define RC4_REGISTRY_MIN_SLOTS 1024 // hash table slots, doubled as needed
+#define RC4_RESCAN_PERIOD_MS 2000   // storage directory polling, without inotify
+#define RC4_INDEX_FILE "rc4.index"
+#define RC4_INDEX_MAGIC "OSRC4IX1"
+
+// rc4.index: a header, then an IndexEntry and its payloads for every file
+struct IndexHeader {
+    char magic[8];
+    uint32_t file_count;
+    uint32_t reserved;
+};
+struct IndexEntry {
+    uint32_t transponder_id;
+    uint32_t payload_count;
+    uint64_t file_size;     // of the .rc4 file, when indexed
+    int64_t mtime;
+};
+
+// GF(2) verification codes of blocks 17..20
+static const uint64_t check_polys[16] = {
+    // block 17:
+    0xc2cd82058e2c0c88ull,
+    0xe166c102c7160644ull,
+    0xf0b36081638b0322ull,
+    0xf859b040b1c58191ull,
+    // block 18:
+    0xbee15a25d6cecc40ull,
+    0xdf70ad12eb676620ull,
+    0x6fb8568975b3b310ull,
+    0xb7dc2b44bad9d988ull,
+    // block 19:
+    0xdbee15a25d6cecc4ull,
+    0x6df70ad12eb67662ull,
+    0x36fb8568975b3b31ull,
+    0x59b040b1c5819110ull,
+    // block 20:
+    0x2cd82058e2c0c888ull,
+    0x166c102c71606444ull,
+    0x0b36081638b03222ull,
+    0x859b040b1c581911ull
+};
+static const uint8_t check_constants[16] = {
+    0, 0, 1, 1,
+    0, 0, 0, 1,
+    0, 0, 1, 1,
+    1, 1, 1, 0
+};
+static const int parity_pos[16] = {
+    80, 81, 82, 83,
+    85, 86, 87, 88,
+    90, 91, 92, 93,
+    95, 96, 97, 98
+};
 
 RC4Message::RC4Message(const uint8_t *softbits) {
     // differential-decode: decoded[i] = raw[i] ^ raw[i-1], assuming raw[-1] = 0
@@ -43,41 +112,6 @@ RC4Message::RC4Message(const uint8_t *softbits) {
 
     // GF(2) verification codes: v[i] = XOR of selected payload bits, XOR constant
     if (is_valid) {
-        static const std::vector<uint64_t> check_polys = {
-            // block 17:
-            0xc2cd82058e2c0c88ull,
-            0xe166c102c7160644ull,
-            0xf0b36081638b0322ull,
-            0xf859b040b1c58191ull,
-            // block 18:
-            0xbee15a25d6cecc40ull,
-            0xdf70ad12eb676620ull,
-            0x6fb8568975b3b310ull,
-            0xb7dc2b44bad9d988ull,
-            // block 19:
-            0xdbee15a25d6cecc4ull,
-            0x6df70ad12eb67662ull,
-            0x36fb8568975b3b31ull,
-            0x59b040b1c5819110ull,
-            // block 20:
-            0x2cd82058e2c0c888ull,
-            0x166c102c71606444ull,
-            0x0b36081638b03222ull,
-            0x859b040b1c581911ull
-        };
-        static const uint8_t check_constants[] = {
-            0, 0, 1, 1,
-            0, 0, 0, 1,
-            0, 0, 1, 1,
-            1, 1, 1, 0
-        };
-        static const int parity_pos[] = {
-            80, 81, 82, 83,
-            85, 86, 87, 88,
-            90, 91, 92, 93,
-            95, 96, 97, 98
-        };
-
         for (int v = 0; v < 16; v++) {
             auto popcount = std::popcount(payload & check_polys[v]);
             auto parity = (popcount + check_constants[v]) % 2;
@@ -89,19 +123,73 @@ RC4Message::RC4Message(const uint8_t *softbits) {
     }
 }
 
-bool RC4Registry::lookup(const uint64_t &rc4_payload, uint32_t *transponder_id) {
-    std::shared_lock<std::shared_mutex> read_lock(mutex);
+void encode_rc4(uint64_t payload, uint8_t *softbits) {
+    uint8_t bits[100] = {0};
+    for (int block = 0; block < 16; block++) {
+        for (int bit = 0; bit < 4; bit++) {
+            bits[block * 5 + bit] = (payload >> (63 - (block * 4 + bit))) & 1;
+        }
+    }
+    for (int v = 0; v < 16; v++) {
+        bits[parity_pos[v]] = (std::popcount(payload & check_polys[v]) + check_constants[v]) % 2;
+    }
+    for (int block = 0; block < 20; block++) {
+        bits[block * 5 + 4] = !bits[block * 5 + 3];
+    }
 
-    auto it = registry.find(rc4_payload);
-    if (it == registry.end())
-        return false;
-    *transponder_id = it->second;
-    return true;
+    // differential-encode, the inverse of the decoder above
+    int prev = 1;
+    for (int i = 0; i < 100; i++) {
+        prev ^= bits[i];
+        softbits[i] = prev ? 255 : 0;
+    }
 }
 
-uint32_t RC4Registry::store(uint32_t transponder_id, std::vector<uint64_t> rc4_payloads) {
-    std::unique_lock<std::shared_mutex> write_lock(mutex);
+// spread the payload bits over the table index
+static size_t home_slot(uint64_t payload, size_t mask) {
+    payload ^= payload >> 33;
+    payload *= 0xff51afd7ed558ccdull;
+    payload ^= payload >> 33;
+    return static_cast<size_t>(payload) & mask;
+}
+
+RC4Registry::RC4Registry() {
+    auto empty = new Snapshot();
+    empty->slots.resize(RC4_REGISTRY_MIN_SLOTS);
+    snapshot.store(empty);
+}
+
+RC4Registry::~RC4Registry() {
+    delete snapshot.load();
+}
 
+bool RC4Registry::lookup(const uint64_t &rc4_payload, uint32_t *transponder_id) {
+    // register as a reader of the current epoch; a writer flipping it in
+    // the meantime might not wait for us, so try again
+    uint64_t reader_epoch;
+    while (true) {
+        reader_epoch = epoch.load();
+        readers[reader_epoch & 1].fetch_add(1);
+        if (epoch.load() == reader_epoch) { break; }
+        readers[reader_epoch & 1].fetch_sub(1);
+    }
+
+    const Snapshot *table = snapshot.load();
+    const size_t mask = table->slots.size() - 1;
+    bool found = false;
+    for (size_t i = home_slot(rc4_payload, mask); table->slots[i].transponder_id != 0; i = (i + 1) & mask) {
+        if (table->slots[i].payload == rc4_payload) {
+            *transponder_id = table->slots[i].transponder_id;
+            found = true;
+            break;
+        }
+    }
+
+    readers[reader_epoch & 1].fetch_sub(1);
+    return found;
+}
+
+uint32_t RC4Registry::assign(uint32_t transponder_id) {
     if (transponder_id >= 1000 && transponder_id <= 9999) {
         if (transponder_id + 1 > next_transponder) {
             next_transponder = transponder_id + 1;
@@ -110,169 +198,486 @@ uint32_t RC4Registry::store(uint32_t transponder_id, std::vector<uint64_t> rc4_p
     if (transponder_id == 0) {
         transponder_id = (next_transponder++);
     }
-    for (const auto &p : rc4_payloads) {
-        registry[p] = transponder_id;
-    }
-
     return transponder_id;
 }
 
-void RC4Registry::remove(uint32_t transponder_id) {
-    std::unique_lock<std::shared_mutex> write_lock(mutex);
+void RC4Registry::publish(const std::vector<std::pair<uint32_t, std::vector<uint64_t>>> &additions, const std::vector<uint32_t> &removals) {
+    const Snapshot *current = snapshot.load();
 
-    for (auto it = registry.begin(); it != registry.end(); ) {
-        if (it->second == transponder_id) {
-            it = registry.erase(it);
-        } else {
-            ++it;
+    size_t added = 0;
+    for (const auto &[transponder_id, payloads] : additions) {
+        added += payloads.size();
+    }
+    size_t slot_count = current->slots.size();
+    while ((current->count + added) * 2 > slot_count) {
+        slot_count *= 2;
+    }
+
+    auto next = std::make_unique<Snapshot>();
+    if (slot_count == current->slots.size()) {
+        *next = *current;
+    } else {
+        next->slots.resize(slot_count);
+        next->count = current->count;
+        for (const Slot &slot : current->slots) {
+            if (slot.transponder_id == 0) { continue; }
+            size_t i = home_slot(slot.payload, slot_count - 1);
+            while (next->slots[i].transponder_id != 0) {
+                i = (i + 1) & (slot_count - 1);
+            }
+            next->slots[i] = slot;
+        }
+    }
+    std::vector<Slot> &slots = next->slots;
+    const size_t mask = slots.size() - 1;
+
+    // removal: only the transponder's own payloads are looked up
+    for (uint32_t transponder_id : removals) {
+        auto entry = transponder_payloads.find(transponder_id);
+        if (entry == transponder_payloads.end()) { continue; }
+        for (uint64_t payload : entry->second) {
+            size_t i = home_slot(payload, mask);
+            while (slots[i].transponder_id != 0 && slots[i].payload != payload) {
+                i = (i + 1) & mask;
+            }
+            if (slots[i].transponder_id != transponder_id) { continue; }
+            // backward-shift deletion: move up the entries which probed past the hole
+            for (size_t j = (i + 1) & mask; slots[j].transponder_id != 0; j = (j + 1) & mask) {
+                const size_t home = home_slot(slots[j].payload, mask);
+                if (((j - home) & mask) >= ((j - i) & mask)) {
+                    slots[i] = slots[j];
+                    i = j;
+                }
+            }
+            slots[i] = {};
+            next->count--;
         }
+        transponder_payloads.erase(entry);
     }
+
+    for (const auto &[transponder_id, payloads] : additions) {
+        std::vector<uint64_t> &own_payloads = transponder_payloads[transponder_id];
+        for (uint64_t payload : payloads) {
+            size_t i = home_slot(payload, mask);
+            while (slots[i].transponder_id != 0 && slots[i].payload != payload) {
+                i = (i + 1) & mask;
+            }
+            const uint32_t previous = slots[i].transponder_id;
+            if (previous == transponder_id) { continue; }
+            if (previous == 0) {
+                next->count++;
+            } else {
+                // the payload moves to an other transponder
+                std::erase(transponder_payloads[previous], payload);
+            }
+            slots[i] = { payload, transponder_id };
+            own_payloads.push_back(payload);
+        }
+    }
+
+    snapshot.store(next.release());
+    // readers registered before the flip may still see the old table
+    const uint64_t old_epoch = epoch.fetch_add(1);
+    while (readers[old_epoch & 1].load() != 0) {
+        std::this_thread::yield();
+    }
+    delete current;
+}
+
+void RC4Registry::update(const std::vector<std::pair<uint32_t, std::vector<uint64_t>>> &additions, const std::vector<uint32_t> &removals) {
+    std::lock_guard<std::mutex> lock(write_mutex);
+
+    for (const auto &[transponder_id, payloads] : additions) {
+        assign(transponder_id);
+    }
+    publish(additions, removals);
+}
+
+uint32_t RC4Registry::store(uint32_t transponder_id, std::vector<uint64_t> rc4_payloads) {
+    std::lock_guard<std::mutex> lock(write_mutex);
+
+    transponder_id = assign(transponder_id);
+    publish({ { transponder_id, std::move(rc4_payloads) } }, {});
+    return transponder_id;
 }
 
 void RC4Registry::resync() {
     // do nothing, work in-memory only
 }
 
+// <directory>/<transponder_id>.rc4
+static bool transponder_file(const std::filesystem::path &path, uint32_t *transponder_id) {
+    if (path.extension() != ".rc4") { return false; }
+
+    const std::string stem = path.stem().string();
+    if (stem.empty() || !std::all_of(stem.begin(), stem.end(), ::isdigit)) {
+        return false;
+    }
+    try { *transponder_id = std::stoul(stem); } catch (...) { return false; }
+    return true;
+}
+
+static int64_t modification_time(const std::filesystem::path &path) {
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    return ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+static std::vector<uint64_t> read_rc4_file(const std::filesystem::path &path) {
+    std::ifstream file(path);
+    std::string line;
+    std::vector<uint64_t> payloads;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.size() == 16) {
+            try {
+                payloads.push_back(std::stoull(line, nullptr, 16));
+            } catch (...) {}
+        } else if (line.size() == 28) {
+            // older pilot format: 28 hex chars = 112 bits
+            // drop first 5 bits, next 100 bits become softbits
+            try {
+                // parse 28 hex chars into 14 bytes
+                uint8_t bytes[14];
+                for (int i = 0; i < 14; i++) {
+                    bytes[i] = (uint8_t)std::stoul(line.substr(i * 2, 2), nullptr, 16);
+                }
+                // extract 100 softbits starting at bit offset 5
+                uint8_t softbits[100];
+                for (int i = 0; i < 100; i++) {
+                    int bit_pos = 5 + i;
+                    int byte_idx = bit_pos / 8;
+                    int bit_idx = 7 - (bit_pos % 8);
+                    softbits[i] = (bytes[byte_idx] >> bit_idx) & 1 ? 0xFF : 0x00;
+                }
+                RC4Message msg(softbits);
+                if (msg.is_valid) {
+                    payloads.push_back(msg.payload);
+                }
+            } catch (...) {}
+        }
+    }
+    return payloads;
+}
+
 RC4FileBasedRegistry::RC4FileBasedRegistry(std::string directory)
-    : directory(std::move(directory)) {}
+    : directory(std::move(directory)) {
+#ifdef __linux__
+    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // IN_CLOSE_WRITE, not IN_CREATE: files copied in are read once complete
+    if (watch_fd >= 0 && inotify_add_watch(watch_fd, this->directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0) {
+        ::close(watch_fd);
+        watch_fd = -1;
+    }
+#endif
+    if (watch_fd < 0) {
+        log_err("RC4 storage is not watched, polling every {} ms", RC4_RESCAN_PERIOD_MS);
+    }
+}
+
+RC4FileBasedRegistry::~RC4FileBasedRegistry() {
+#ifdef __linux__
+    if (watch_fd >= 0) {
+        ::close(watch_fd);
+    }
+#endif
+}
 
 uint32_t RC4FileBasedRegistry::store(uint32_t transponder_id, std::vector<uint64_t> rc4_payloads) {
+    std::lock_guard<std::mutex> lock(files_mutex);
+
     transponder_id = RC4Registry::store(transponder_id, rc4_payloads);
-    loaded_ids.insert(transponder_id);
 
-    std::ofstream file(directory + "/" + std::to_string(transponder_id) + ".rc4", std::ios::app);
-    for (const auto &p : rc4_payloads) {
-        char buf[17];
-        snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)p);
-        file << buf << "\n";
+    const std::string path = directory + "/" + std::to_string(transponder_id) + ".rc4";
+    {
+        std::ofstream file(path, std::ios::app);
+        for (const auto &p : rc4_payloads) {
+            char buf[17];
+            snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)p);
+            file << buf << "\n";
+        }
     }
 
+    // keep the index in step with the file, it is not re-read
+    LoadedFile &loaded = files[transponder_id];
+    loaded.payloads.insert(loaded.payloads.end(), rc4_payloads.begin(), rc4_payloads.end());
+    std::error_code ec;
+    loaded.size = std::filesystem::file_size(path, ec);
+    loaded.mtime = modification_time(path);
+    index_dirty = true;
+
     return transponder_id;
 }
 
-void RC4FileBasedRegistry::resync() {
+void RC4FileBasedRegistry::load(const std::string &path, uint32_t transponder_id, std::vector<std::pair<uint32_t, std::vector<uint64_t>>> *additions) {
+    LoadedFile loaded;
+    std::error_code ec;
+    loaded.size = std::filesystem::file_size(path, ec);
+    loaded.mtime = modification_time(path);
+
+    // unchanged since the index was written: no need to parse it
+    auto cached = index.find(transponder_id);
+    if (cached != index.end() && cached->second.size == loaded.size && cached->second.mtime == loaded.mtime) {
+        loaded.payloads = std::move(cached->second.payloads);
+    } else {
+        loaded.payloads = read_rc4_file(path);
+        index_dirty = true;
+    }
+
+    if (!loaded.payloads.empty()) {
+        log_err("RC4 transpoder loaded: {}", transponder_id);
+        additions->emplace_back(transponder_id, loaded.payloads);
+    }
+    files[transponder_id] = std::move(loaded);
+}
+
+void RC4FileBasedRegistry::scan() {
     namespace fs = std::filesystem;
 
     std::set<uint32_t> current_ids;
+    std::vector<std::pair<uint32_t, std::vector<uint64_t>>> additions;
+    std::vector<uint32_t> removals;
 
     for (const auto &entry : fs::directory_iterator(directory)) {
-        if (!entry.is_regular_file()) { continue; }
-        const auto &path = entry.path();
-        if (path.extension() != ".rc4") { continue; }
+        uint32_t id;
+        if (!entry.is_regular_file() || !transponder_file(entry.path(), &id)) { continue; }
 
-        const std::string stem = path.stem().string();
-        if (stem.empty() || !std::all_of(stem.begin(), stem.end(), ::isdigit)) {
-            continue;
+        current_ids.insert(id);
+        // do not re-load already loaded (even if content has changed!)
+        if (files.count(id)) { continue; }
+        load(entry.path().string(), id, &additions);
+    }
+
+    for (auto it = files.begin(); it != files.end(); ) {
+        if (!current_ids.count(it->first)) {
+            removals.push_back(it->first);
+            log_err("RC4 transpoder removed: {}", it->first);
+            it = files.erase(it);
+            index_dirty = true;
+        } else {
+            ++it;
         }
+    }
+    if (!additions.empty() || !removals.empty()) {
+        update(additions, removals);
+    }
+}
+
+void RC4FileBasedRegistry::refresh(const std::set<std::string> &names) {
+    namespace fs = std::filesystem;
+
+    std::vector<std::pair<uint32_t, std::vector<uint64_t>>> additions;
+    std::vector<uint32_t> removals;
 
+    for (const auto &name : names) {
+        const fs::path path = fs::path(directory) / name;
         uint32_t id;
-        try { id = std::stoul(stem); } catch (...) { continue; }
+        if (!transponder_file(path, &id)) { continue; }
+
+        std::error_code ec;
+        const bool exists = fs::is_regular_file(path, ec);
+        if (exists && !files.count(id)) {
+            load(path.string(), id, &additions);
+        } else if (!exists && files.count(id)) {
+            removals.push_back(id);
+            log_err("RC4 transpoder removed: {}", id);
+            files.erase(id);
+            index_dirty = true;
+        }
+    }
+    if (!additions.empty() || !removals.empty()) {
+        update(additions, removals);
+    }
+}
 
-        current_ids.insert(id);
-        // do not re-load already loaded (even if content has changed!)
-        if (loaded_ids.count(id)) { continue; }
-
-        std::ifstream file(path);
-        std::string line;
-        std::vector<uint64_t> payloads;
-        while (std::getline(file, line)) {
-            if (!line.empty() && line.back() == '\r') line.pop_back();
-            if (line.size() == 16) {
-                try {
-                    payloads.push_back(std::stoull(line, nullptr, 16));
-                } catch (...) {}
-            } else if (line.size() == 28) {
-                // older pilot format: 28 hex chars = 112 bits
-                // drop first 5 bits, next 100 bits become softbits
-                try {
-                    // parse 28 hex chars into 14 bytes
-                    uint8_t bytes[14];
-                    for (int i = 0; i < 14; i++) {
-                        bytes[i] = (uint8_t)std::stoul(line.substr(i * 2, 2), nullptr, 16);
-                    }
-                    // extract 100 softbits starting at bit offset 5
-                    uint8_t softbits[100];
-                    for (int i = 0; i < 100; i++) {
-                        int bit_pos = 5 + i;
-                        int byte_idx = bit_pos / 8;
-                        int bit_idx = 7 - (bit_pos % 8);
-                        softbits[i] = (bytes[byte_idx] >> bit_idx) & 1 ? 0xFF : 0x00;
-                    }
-                    RC4Message msg(softbits);
-                    if (msg.is_valid) {
-                        payloads.push_back(msg.payload);
-                    }
-                } catch (...) {}
-            }
+void RC4FileBasedRegistry::read_index() {
+    MappedFile mapped;
+    if (!mapped.open(directory + "/" + RC4_INDEX_FILE) || mapped.size() < sizeof(IndexHeader)) {
+        return;
+    }
+    const uint8_t *data = mapped.data();
+    IndexHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, RC4_INDEX_MAGIC, sizeof(header.magic)) != 0) {
+        return;
+    }
+
+    size_t offset = sizeof(IndexHeader);
+    for (uint32_t i = 0; i < header.file_count; i++) {
+        IndexEntry entry;
+        if (offset + sizeof(entry) > mapped.size()) { break; }
+        std::memcpy(&entry, data + offset, sizeof(entry));
+        offset += sizeof(entry);
+        if (offset + entry.payload_count * sizeof(uint64_t) > mapped.size()) { break; }
+
+        LoadedFile &cached = index[entry.transponder_id];
+        cached.size = entry.file_size;
+        cached.mtime = entry.mtime;
+        cached.payloads.resize(entry.payload_count);
+        std::memcpy(cached.payloads.data(), data + offset, entry.payload_count * sizeof(uint64_t));
+        offset += entry.payload_count * sizeof(uint64_t);
+    }
+}
+
+void RC4FileBasedRegistry::write_index() {
+    // written aside, then renamed over: a reader never sees half of it
+    const std::string path = directory + "/" + RC4_INDEX_FILE;
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        IndexHeader header = {};
+        std::memcpy(header.magic, RC4_INDEX_MAGIC, sizeof(header.magic));
+        header.file_count = static_cast<uint32_t>(files.size());
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (const auto &[transponder_id, loaded] : files) {
+            const IndexEntry entry = {
+                transponder_id,
+                static_cast<uint32_t>(loaded.payloads.size()),
+                loaded.size,
+                loaded.mtime
+            };
+            file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+            file.write(reinterpret_cast<const char *>(loaded.payloads.data()), loaded.payloads.size() * sizeof(uint64_t));
         }
-        if (!payloads.empty()) {
-            std::cerr << "RC4 transpoder loaded: " << id << std::endl;
-            RC4Registry::store(id, payloads);
+        if (!file) {
+            log_err("Can not write RC4 index: {}", temporary);
+            return;
         }
-        loaded_ids.insert(id);
     }
+    std::error_code ec;
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        log_err("Can not write RC4 index: {}", path);
+    }
+}
 
-    for (auto it = loaded_ids.begin(); it != loaded_ids.end(); ) {
-        if (!current_ids.count(*it)) {
-            RC4Registry::remove(*it);
-            std::cerr << "RC4 transpoder removed: " << (*it) << std::endl;
-            it = loaded_ids.erase(it);
+bool RC4FileBasedRegistry::changed(std::set<std::string> *names) {
+#ifdef __linux__
+    if (watch_fd >= 0) {
+        alignas(struct inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = ::read(watch_fd, buffer, sizeof(buffer))) > 0) {
+            for (char *p = buffer; p < buffer + length; ) {
+                const auto *event = reinterpret_cast<const struct inotify_event *>(p);
+                if (event->mask & IN_Q_OVERFLOW) {
+                    names->clear();
+                    rescan = true;
+                } else if (event->len > 0) {
+                    names->insert(event->name);
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        return rescan || !names->empty();
+    }
+#endif
+    const auto now = std::chrono::steady_clock::now();
+    if (now < next_rescan) {
+        return false;
+    }
+    next_rescan = now + std::chrono::milliseconds(RC4_RESCAN_PERIOD_MS);
+    rescan = true;
+    return true;
+}
+
+void RC4FileBasedRegistry::resync() {
+    std::lock_guard<std::mutex> lock(files_mutex);
+
+    std::set<std::string> names;
+    if (!scanned) {
+        // the first scan: files unchanged since the last run come from the index
+        read_index();
+        scan();
+        index.clear();
+        scanned = true;
+    } else if (changed(&names)) {
+        if (rescan) {
+            scan();
+            rescan = false;
         } else {
-            ++it;
+            refresh(names);
         }
     }
+
+    if (index_dirty) {
+        write_index();
+        index_dirty = false;
+    }
 }
 
-void RC4Trainer::append(uint64_t timestamp, float rssi, uint32_t transponder_id, uint64_t rc4_payload) {
-    std::lock_guard<std::mutex> lock(mutex);
+void RC4Trainer::Session::reset(float rssi) {
+    state = IDLE;
+    id = 0;
+    center = rssi;
+    first = 0;
+    end = 0;
+    rssi_min.clear();
+    rssi_max.clear();
+    recent_rssi_min.clear();
+    recent_rssi_max.clear();
+    payload_counts.clear(); // keeps the buckets
+}
 
-    buffer.push_back({timestamp, rc4_payload, rssi, transponder_id});
-    if (buffer.size() > BUFFER_MAX_SIZE) {
-        buffer.pop_front();
+void RC4Trainer::Session::drop_until(uint64_t position) {
+    for (; first < position; first++) {
+        auto count = payload_counts.find(at(first).rc4_payload);
+        if (--count->second == 0) {
+            payload_counts.erase(count);
+        }
     }
+    rssi_min.expire(first);
+    rssi_max.expire(first);
+    recent_rssi_min.expire(first);
+    recent_rssi_max.expire(first);
 }
 
-RC4Trainer::EvaluationResult RC4Trainer::evaluate(uint64_t timestamp) {
-    std::lock_guard<std::mutex> lock(mutex);
+void RC4Trainer::Session::append(const Entry &entry) {
+    if (size() == BUFFER_MAX_SIZE) {
+        drop_until(first + 1);
+    }
+    at(end) = entry;
+    payload_counts[entry.rc4_payload]++;
+    rssi_min.push(end, entry.rssi);
+    rssi_max.push(end, entry.rssi);
+    if (end >= STABLE_WINDOW) {
+        recent_rssi_min.expire(end - STABLE_WINDOW + 1);
+        recent_rssi_max.expire(end - STABLE_WINDOW + 1);
+    }
+    recent_rssi_min.push(end, entry.rssi);
+    recent_rssi_max.push(end, entry.rssi);
+    end++;
+}
 
+RC4Trainer::EvaluationResult RC4Trainer::Session::evaluate(uint64_t timestamp) {
     switch (state) {
         case state_t::IDLE: {
-            if (buffer.size() < 128) break;
-            const Entry &last = buffer.back();
+            if (size() < STABLE_WINDOW) break;
+            const Entry &last = at(end - 1);
             if ((int64_t)(timestamp - last.timestamp) > 100000 || last.rssi <= RC4_TRAINING_RSSI_LIMIT) break;
-            auto tail = std::prev(buffer.end(), 128);
-            auto [mn, mx] = std::minmax_element(
-                tail,
-                buffer.end(),
-                [](const Entry &a, const Entry &b) { return a.rssi < b.rssi; }
-            );
-            bool stable = (int64_t)(last.timestamp - tail->timestamp) <= 1000000 &&
-                          mx->rssi - mn->rssi <= 2.0f;
+            const uint64_t tail = end - STABLE_WINDOW;
+            bool stable = (int64_t)(last.timestamp - at(tail).timestamp) <= 1000000 &&
+                          recent_rssi_max.value() - recent_rssi_min.value() <= 2.0f;
             if (stable) {
                 state = state_t::TRAINING;
-                buffer.erase(buffer.begin(), tail);
+                center = (recent_rssi_max.value() + recent_rssi_min.value()) / 2.0f;
+                drop_until(tail);
                 return EvaluationResult::START;
             }
         }
         break;
 
         case state_t::TRAINING: {
-            const Entry &last = buffer.back();
+            const Entry &last = at(end - 1);
             if ((int64_t)(timestamp - last.timestamp) > 500000) {
                 state = state_t::IDLE;
                 return EvaluationResult::INTERRUPED;
             }
-            auto [mn, mx] = std::minmax_element(
-                buffer.begin(),
-                buffer.end(),
-                [](const Entry &a, const Entry &b) { return a.rssi < b.rssi; }
-            );
-            bool stable = (mx->rssi - mn->rssi) <= 3.0f;
+            bool stable = (rssi_max.value() - rssi_min.value()) <= 3.0f;
             if (!stable) {
                 state = state_t::IDLE;
                 return EvaluationResult::INTERRUPED;
             }
-            if (buffer.size() >= BUFFER_MAX_SIZE) {
+            if (size() >= BUFFER_MAX_SIZE) {
                 state = state_t::FINALIZING;
                 return EvaluationResult::DONE;
             }
@@ -280,7 +685,7 @@ RC4Trainer::EvaluationResult RC4Trainer::evaluate(uint64_t timestamp) {
         break;
 
         case state_t::FINALIZING: {
-            const Entry &last = buffer.back();
+            const Entry &last = at(end - 1);
             if ((int64_t)(timestamp - last.timestamp) > 1000000) {
                 state = state_t::IDLE;
                 return EvaluationResult::RESET;
@@ -291,38 +696,138 @@ RC4Trainer::EvaluationResult RC4Trainer::evaluate(uint64_t timestamp) {
     return EvaluationResult::NO_ACTION;
 }
 
-std::vector<uint64_t> RC4Trainer::registry_payloads() {
-    std::lock_guard<std::mutex> lock(mutex);
-
-    std::map<uint64_t, int> counts;
-    for (const auto &e : buffer) {
-        counts[e.rc4_payload]++;
+uint32_t RC4Trainer::Session::preferred_transponder_id() {
+    for (uint64_t position = first; position < end; position++) {
+        if (at(position).transponder_id != 0) {
+            return at(position).transponder_id;
+        }
     }
+    return 0;
+}
+
+std::vector<uint64_t> RC4Trainer::registry_payloads(const Session &session) const {
+    auto repeated_elsewhere = [this, &session](uint64_t payload) {
+        for (const auto &other : sessions) {
+            if (other == &session) { continue; }
+            auto count = other->payload_counts.find(payload);
+            if (count != other->payload_counts.end() && count->second > 1) {
+                return true;
+            }
+        }
+        return false;
+    };
+
     std::vector<uint64_t> payloads;
-    for (const auto &[p, count] : counts) {
-        if (count > 1) {
+    for (const auto &[p, count] : session.payload_counts) {
+        if (count > 1 && !repeated_elsewhere(p)) {
             payloads.push_back(p);
         }
     }
+    std::sort(payloads.begin(), payloads.end());
     return payloads;
 }
 
-uint32_t RC4Trainer::preferred_transponder_id() {
-    std::lock_guard<std::mutex> lock(mutex);
+RC4Trainer::RC4Trainer() {
+    pool.reserve(RC4_MAX_SESSIONS);
+    sessions.reserve(RC4_MAX_SESSIONS);
+    spare.reserve(RC4_MAX_SESSIONS);
+    for (size_t i = 0; i < RC4_MAX_SESSIONS; i++) {
+        pool.push_back(std::make_unique<Session>());
+        spare.push_back(pool.back().get());
+    }
+}
 
-    auto known = std::find_if(
-        buffer.begin(), buffer.end(),
-        [](const Entry &e) { return e.transponder_id != 0; }
-    );
-    return known != buffer.end() ? known->transponder_id : 0;
+void RC4Trainer::release(size_t index) {
+    spare.push_back(sessions[index]);
+    sessions.erase(sessions.begin() + index);
 }
 
-std::pair<uint64_t, uint64_t> RC4Trainer::buffer_timerange() {
+void RC4Trainer::append(uint64_t timestamp, float rssi, uint32_t transponder_id, uint64_t rc4_payload) {
     std::lock_guard<std::mutex> lock(mutex);
-    return std::make_pair(buffer.front().timestamp, buffer.back().timestamp);
+
+    Session *nearest = nullptr;
+    float distance = RC4_SESSION_RSSI_DB;
+    for (Session *session : sessions) {
+        if (std::abs(rssi - session->center) <= distance) {
+            nearest = session;
+            distance = std::abs(rssi - session->center);
+        }
+    }
+
+    if (nearest == nullptr) {
+        // a new cluster; only strong signals can start training
+        if (rssi <= RC4_TRAINING_RSSI_LIMIT) {
+            return;
+        }
+        if (spare.empty()) {
+            // make room by forgetting the idle session heard the longest ago
+            size_t stalest = sessions.size();
+            for (size_t i = 0; i < sessions.size(); i++) {
+                Session &session = *sessions[i];
+                if (session.state == Session::IDLE &&
+                    (stalest == sessions.size() || session.at(session.end - 1).timestamp < sessions[stalest]->at(sessions[stalest]->end - 1).timestamp)) {
+                    stalest = i;
+                }
+            }
+            if (stalest == sessions.size()) {
+                return;
+            }
+            release(stalest);
+        }
+        nearest = spare.back();
+        spare.pop_back();
+        nearest->reset(rssi);
+        sessions.push_back(nearest);
+    } else if (nearest->state == Session::IDLE) {
+        nearest->center += (rssi - nearest->center) / RC4_SESSION_CENTER_AVERAGING;
+    }
+    nearest->append({timestamp, rc4_payload, rssi, transponder_id});
 }
 
-float RC4Trainer::last_rssi() {
+std::vector<RC4Trainer::Event> RC4Trainer::evaluate(uint64_t timestamp) {
     std::lock_guard<std::mutex> lock(mutex);
-    return buffer.back().rssi;
+
+    std::vector<Event> events;
+    for (size_t i = 0; i < sessions.size(); ) {
+        Session &session = *sessions[i];
+        const EvaluationResult result = session.evaluate(timestamp);
+        bool keep = true;
+
+        Event event;
+        event.result = result;
+        switch (result) {
+            case EvaluationResult::START:
+            session.id = next_session++;
+            event.rssi = session.at(session.end - 1).rssi;
+            break;
+            case EvaluationResult::DONE:
+            event.preferred_transponder_id = session.preferred_transponder_id();
+            event.payloads = registry_payloads(session);
+            event.timestamp_from = session.at(session.first).timestamp;
+            event.timestamp_until = session.at(session.end - 1).timestamp;
+            event.rssi_low = session.rssi_min.value() - RC4_SESSION_RSSI_DB;
+            event.rssi_high = session.rssi_max.value() + RC4_SESSION_RSSI_DB;
+            break;
+            case EvaluationResult::INTERRUPED:
+            case EvaluationResult::RESET:
+            keep = false; // the frames heard next form a new session
+            break;
+            case EvaluationResult::NO_ACTION:
+            // a cluster which did not turn into a training (ie. a passing car)
+            keep = session.state != Session::IDLE ||
+                   (int64_t)(timestamp - session.at(session.end - 1).timestamp) <= RC4_SESSION_IDLE_US;
+            break;
+        }
+        if (result != EvaluationResult::NO_ACTION) {
+            event.session = session.id;
+            events.push_back(std::move(event));
+        }
+
+        if (keep) {
+            i++;
+        } else {
+            release(i);
+        }
+    }
+    return events;
 }
@@ -1,16 +1,21 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <ostream>
 #include <string>
-#include <deque>
+#include <functional>
 #include <map>
+#include <memory>
 #include <set>
 #include <mutex>
-#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <optional>
 
 #include "frame.hpp"
+#include "sliding_extreme.hpp"
 
 
 struct RC4Message {
@@ -21,33 +26,128 @@ struct RC4Message {
     RC4Message(const uint8_t *softbits);
 };
 
+// inverse of RC4Message: payload -> 100 hard-decision softbits (0 or 255)
+void encode_rc4(uint64_t payload, uint8_t *softbits);
+
+// Payload -> transponder id lookups, on the DSP threads, for every valid RC4
+// frame.
+//
+// Readers never lock: the table is an immutable open-addressing hash table
+// (linear probing, at most half full), published through an atomic pointer.
+// Writers are serialized; they copy the current table, apply their changes and
+// swap the pointer. The old table is freed once the readers which might still
+// see it are gone: readers register on one of two counters by epoch parity,
+// and the writer flips the epoch, then waits for the old parity to drain.
 class RC4Registry {
-    std::shared_mutex mutex;
-    std::map<uint64_t, uint32_t> registry;
+    struct Slot {
+        uint64_t payload;
+        uint32_t transponder_id; // 0: empty
+    };
+    struct Snapshot {
+        std::vector<Slot> slots; // power of 2
+        size_t count = 0;
+    };
+
+    std::atomic<const Snapshot*> snapshot;
+    std::atomic<uint64_t> epoch = 0;
+    std::atomic<uint32_t> readers[2] = {};
+
+    std::mutex write_mutex;
+    std::map<uint32_t, std::vector<uint64_t>> transponder_payloads; // reverse index, writers only
     uint32_t next_transponder = 1000u;
 
+    uint32_t assign(uint32_t transponder_id);
+    void publish(const std::vector<std::pair<uint32_t, std::vector<uint64_t>>> &additions, const std::vector<uint32_t> &removals);
+
 protected:
-    void remove(uint32_t transponder_id);
+    // a batch of changes, published as a single table
+    void update(const std::vector<std::pair<uint32_t, std::vector<uint64_t>>> &additions, const std::vector<uint32_t> &removals);
 
 public:
-    virtual ~RC4Registry() = default;
+    RC4Registry();
+    RC4Registry(const RC4Registry &) = delete;
+    RC4Registry &operator=(const RC4Registry &) = delete;
+    virtual ~RC4Registry();
     bool lookup(const uint64_t &rc4_payload, uint32_t *transponder_id);
     virtual uint32_t store(uint32_t transponder_id, std::vector<uint64_t> rc4_payloads);
     virtual void resync();
 };
 
+// Transponders learned to <directory>/<transponder_id>.rc4 files.
+//
+// Changes of the directory are followed with inotify (polled every
+// RC4_RESCAN_PERIOD_MS where it is not available); only the files named in
+// the events are looked at. The payloads of every file are also kept in a
+// binary index (rc4.index, memory-mapped on startup), so files which did not
+// change since the last run (same size and mtime) are not parsed again.
 class RC4FileBasedRegistry : public RC4Registry {
+    struct LoadedFile {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        std::vector<uint64_t> payloads;
+    };
+
     std::string directory;
-    std::set<uint32_t> loaded_ids;
+    std::mutex files_mutex;
+    std::map<uint32_t, LoadedFile> files;  // loaded, by transponder id
+    std::map<uint32_t, LoadedFile> index;  // read from rc4.index, until the first scan is done
+    bool index_dirty = false;
+    bool scanned = false;
+    bool rescan = false;
+    int watch_fd = -1;                     // inotify; -1: polling
+    std::chrono::steady_clock::time_point next_rescan;
+
+    bool changed(std::set<std::string> *names);
+    void load(const std::string &path, uint32_t transponder_id, std::vector<std::pair<uint32_t, std::vector<uint64_t>>> *additions);
+    void scan();
+    void refresh(const std::set<std::string> &names);
+    void read_index();
+    void write_index();
 
 public:
     explicit RC4FileBasedRegistry(std::string directory);
+    ~RC4FileBasedRegistry() override;
     uint32_t store(uint32_t transponder_id, std::vector<uint64_t> rc4_payloads) override;
     void resync() override;
 };
 
+// Learns unknown RC4 transponders parked on the loop.
+//
+// Frames are clustered by RSSI: cars parked at different spots of the loop
+// are heard at different, steady levels. A frame belongs to the session with
+// the nearest RSSI within RC4_SESSION_RSSI_DB; others open a new session.
+// Each session runs its own state machine (IDLE -> TRAINING -> FINALIZING),
+// so several transponders can be learned at once. Payloads repeated in more
+// than one session are not registered by any of them.
+//
+// Arrival timing is not a clustering criterion: parked transponders all
+// repeat at about the same rate, with free-running phases that drift against
+// each other, so their frames interleave and timing alone does not tell them
+// apart. It is used per session instead, where a gap in the frames ends the
+// training (see Session::evaluate()).
+//
+// The sessions are allocated once, up to RC4_MAX_SESSIONS, and reused: the
+// frame buffers are too large to allocate on the receiver thread.
 class RC4Trainer {
+public:
+    enum EvaluationResult { NO_ACTION, START, INTERRUPED, DONE, RESET };
+
+    // a state change of a training session
+    struct Event {
+        EvaluationResult result;
+        uint32_t session;                  // numbered from 1, on START
+        float rssi = 0.0f;                 // START: RSSI of the last frame
+        uint32_t preferred_transponder_id = 0; // DONE: known id of the frames, if any
+        std::vector<uint64_t> payloads;    // DONE: the payloads to register
+        uint64_t timestamp_from = 0;       // DONE: the frames of the session are
+        uint64_t timestamp_until = 0;      //       from this time range...
+        float rssi_low = 0.0f;             //       ...and this RSSI range
+        float rssi_high = 0.0f;
+    };
+
+private:
     static constexpr size_t BUFFER_MAX_SIZE = 8196;
+    static constexpr size_t STABLE_WINDOW = 128; // entries of a stable signal to start training
 
     struct Entry {
         uint64_t timestamp;
@@ -56,17 +156,46 @@ class RC4Trainer {
         uint32_t transponder_id;
     };
 
+    // the frames of one cluster from position <first> up to <end>, in a fixed
+    // ring; the statistics evaluate() needs are kept up to date as entries
+    // come and go
+    struct Session {
+        enum state_t { IDLE, TRAINING, FINALIZING } state = IDLE;
+        uint32_t id = 0;
+        float center = 0.0f;  // RSSI the frames are matched to; fixed once training
+        std::vector<Entry> buffer = std::vector<Entry>(BUFFER_MAX_SIZE);
+        uint64_t first = 0;
+        uint64_t end = 0;
+        SlidingExtreme<float, std::less<float>> rssi_min{BUFFER_MAX_SIZE};
+        SlidingExtreme<float, std::greater<float>> rssi_max{BUFFER_MAX_SIZE};
+        SlidingExtreme<float, std::less<float>> recent_rssi_min{STABLE_WINDOW};
+        SlidingExtreme<float, std::greater<float>> recent_rssi_max{STABLE_WINDOW};
+        std::unordered_map<uint64_t, uint32_t> payload_counts;
+
+        Session() { payload_counts.reserve(BUFFER_MAX_SIZE); }
+
+        void reset(float rssi);
+
+        Entry &at(uint64_t position) { return buffer[position % BUFFER_MAX_SIZE]; }
+        size_t size() const { return end - first; }
+        void drop_until(uint64_t position);
+        void append(const Entry &entry);
+        EvaluationResult evaluate(uint64_t timestamp);
+        uint32_t preferred_transponder_id();
+    };
+
     std::mutex mutex;
-    enum state_t { IDLE, TRAINING, FINALIZING } state = IDLE;
-    std::deque<Entry> buffer;
+    std::vector<std::unique_ptr<Session>> pool;
+    std::vector<Session*> sessions; // in use, oldest first
+    std::vector<Session*> spare;
+    uint32_t next_session = 1;
 
-public:
-    enum EvaluationResult { NO_ACTION, START, INTERRUPED, DONE, RESET };
+    void release(size_t index);
 
+    std::vector<uint64_t> registry_payloads(const Session &session) const;
+
+public:
+    RC4Trainer();
     void append(uint64_t timestamp, float rssi, uint32_t transponder_id, uint64_t rc4_payload);
-    EvaluationResult evaluate(uint64_t timestamp);
-    std::vector<uint64_t> registry_payloads();
-    uint32_t preferred_transponder_id();
-    std::pair<uint64_t, uint64_t> buffer_timerange();
-    float last_rssi();
+    std::vector<Event> evaluate(uint64_t timestamp);
 };
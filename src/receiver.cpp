@@ -0,0 +1,186 @@
+#include "receiver.hpp"
+
+template<int SPS>
+bool SpsFrameReceiver<SPS>::process(const std::complex<int8_t>* samples, size_t sample_count,
+                                    uint64_t timecode, uint64_t timestamp,
+                                    const std::function<void(Frame*)>& on_frame,
+                                    const std::function<void(const Frame*, FrameOutcome)>& on_abort) {
+    // on USB hiccup, there might be a super-small buffer, which can not even fit
+    // the preamble; these buffers should be dropped as bougus to prevent indexing
+    // issues later on.
+    if (sample_count < SymbolReader<SPS>::reserve_buffer_size) {
+        return false; // no meaningful work here
+    }
+
+    bool frame_detected = false;
+    for (uint32_t idx=0; (idx+SPS)<=sample_count; idx+=SPS) {
+        if (frame_parse_mode == FRAME_SEEK) {
+            const std::optional<DetectionResult> detected = frame_detector.process_baseband(samples+idx);
+            if (detected) {
+                frame_parse_mode = FRAME_WAIT;
+                frame_detected = true; // do not use this buffer for noisefloor calculation
+                frame = Frame(
+                    detected.value().first,
+                    detected.value().second,
+                    timestamp + (static_cast<uint64_t>(idx) * 1000000ull / (SYMBOL_RATE * SPS)), // "UL" on windows is 4 bytes :o
+                    timecode + idx
+                );
+                // defer training by fseq_halflen symbols: the centered EQ needs the
+                // trailing (future) symbols, which become ordinary past samples once
+                // they arrive. timing stays anchored at this detection point.
+                pending_trail = SymbolWindow::fseq_halflen;
+            }
+        } else if (frame_parse_mode == FRAME_WAIT) {
+            // count the trailing symbols of the centered EQ window; once they are in,
+            // train/read the preamble looking both back (lead) and ahead (trailing).
+            if (--pending_trail == 0) {
+                const int end = idx + SPS;
+                symbol_reader.train_preamble(&frame, samples, end, frame_detector.dc_offset());
+                symbol_reader.read_preamble(&frame, samples, end, frame_detector.dc_offset());
+                frame_parse_mode = FRAME_FOUND;
+            }
+        } else if (frame_parse_mode == FRAME_FOUND) {
+            symbol_reader.read_symbol(&frame, samples+idx, frame_detector.dc_offset());
+            if (symbol_reader.is_frame_complete(&frame)) {
+                frame_parse_mode = FRAME_SEEK;
+                on_frame(&frame);
+            } else if (FrameOutcome outcome; !symbol_reader.is_frame_viable(&frame, &outcome)) {
+                // hopeless: back to seeking, instead of staying blind until
+                // the rest of the frame went by
+                frame_parse_mode = FRAME_SEEK;
+                if (on_abort) {
+                    on_abort(&frame, outcome);
+                }
+            }
+        }
+    }
+
+    // save a small section of the buffer
+    // if there is a frame in the next buffer, and read_preamble() must
+    // look back, here save the trailing section of the current buffer
+    symbol_reader.update_reserve_buffer(samples, sample_count);
+
+    // update counters for noise energy and dc offset
+    if (frame_detected) {
+        // there was an active frame in the buffer, do not update
+        // statistics, as the received data messes with the
+        // noise/dc-offset calculation
+        frame_detector.reset_statistics_counters();
+        return false;
+    }
+    frame_detector.update_statistics();
+    return true;
+}
+
+template class SpsFrameReceiver<2>;
+template class SpsFrameReceiver<4>;
+template class SpsFrameReceiver<8>;
+
+std::unique_ptr<FrameReceiver> make_frame_receiver(int samples_per_symbol) {
+    switch (samples_per_symbol) {
+        case 2:
+        return std::make_unique<SpsFrameReceiver<2>>();
+        case 4:
+        return std::make_unique<SpsFrameReceiver<4>>();
+        case 8:
+        return std::make_unique<SpsFrameReceiver<8>>();
+    }
+    return nullptr;
+}
+
+bool decode_frame(Frame* frame, DecodedFrame* decoded) {
+    // softbits is null if the preamble was not found
+    const uint8_t *softbits = frame->bits();
+    if (!softbits) {
+        return false;
+    }
+
+    decoded->protocol = frame->transponder_protocol;
+    decoded->timestamp = frame->timestamp;
+    decoded->timecode = frame->timecode;
+    decoded->rssi = frame->rssi();
+    decoded->status_code = 0;
+
+    uint32_t transponder_id;
+    switch (frame->transponder_protocol) {
+        case TransponderProtocol::OpenStint:
+        if (decode_openstint(softbits, &transponder_id)) {
+            decoded->message = transponder_id;
+            return true;
+        }
+        break;
+        case TransponderProtocol::RC3:
+        if (decode_rc3(softbits, &transponder_id, &decoded->status_code)) {
+            decoded->message = transponder_id;
+            return true;
+        }
+        break;
+        case TransponderProtocol::RC4: {
+            RC4Message msg(softbits);
+            if (msg.is_valid) {
+                decoded->message = msg.payload;
+                return true;
+            }
+        }
+        break;
+    }
+    return false;
+}
+
+DetectionRouter::DetectionRouter(PassingDetector& _passing_detector, RC4Registry& _rc4_registry, RC4Trainer* _rc4_trainer)
+    : passing_detector(_passing_detector), rc4_registry(_rc4_registry), rc4_trainer(_rc4_trainer) {}
+
+bool DetectionRouter::route(const DecodedFrame& decoded) {
+    const TransponderSystem tsys = transponder_system(decoded.protocol);
+    const Detection detection(decoded.timestamp, decoded.timecode, decoded.rssi);
+    switch (decoded.protocol) {
+        case TransponderProtocol::OpenStint: {
+            const uint32_t message = static_cast<uint32_t>(decoded.message);
+            if (message < 10000000u) {
+                passing_detector.append({ tsys, message }, detection);
+            } else if ((message & 0x00A00000) == 0x00A00000) {
+                uint32_t transponder_timestamp = (message & 0x000FFFFF);
+                passing_detector.timesync(decoded.timestamp, transponder_timestamp);
+            }
+            return true;
+        }
+        case TransponderProtocol::RC3: {
+            const uint32_t transponder_id = static_cast<uint32_t>(decoded.message);
+            const uint8_t status_code = decoded.status_code;
+            if (transponder_id >= 10000000) { // not a 7-digit transponder for sure
+                // check for known status/validation message (to track some statistics)
+                return ((status_code & 0x07) == 0);
+            }
+            // status byte:
+            // https://www.rctech.net/forum/showpost.php?p=16244070&postcount=1171
+            // RC4 hybrid and "recent" RC3 indicate status messages in lower 3 bits (0x07 mask)
+            // Older RC3 indicate normal messages by setting all bits 1 (0xff)
+
+            // Old AMBRc DP transponders send *transponder* frames with all status bits set (0xff);
+            // unfortunately newer models can transmit RC3 status/validation messages the same way.
+            // Let's build a block-list for such transponders.
+            ambrc_blacklist.process(decoded.timestamp, status_code, transponder_id);
+            if (status_code == 0xff && !ambrc_blacklist.check_banned(transponder_id)) {
+                passing_detector.append({ tsys, transponder_id }, detection);
+            } else if ((status_code & 0x07) == 0) { // not a status/validation message for sure
+                passing_detector.append({ tsys, transponder_id }, detection);
+            }
+            // at this point decoding was success; if status byte indicates
+            // non-transponder message, it should not screw decoded statistics
+            return true;
+        }
+        case TransponderProtocol::RC4: {
+            uint32_t transponder_id;
+            if (rc4_registry.lookup(decoded.message, &transponder_id)) {
+                passing_detector.append({ tsys, transponder_id }, detection);
+            } else {
+                transponder_id = 0;
+            }
+            if (rc4_trainer) {
+                rc4_trainer->append(decoded.timestamp, decoded.rssi, transponder_id, decoded.message);
+            }
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "frame.hpp"
+#include "transponder.hpp"
+#include "passing.hpp"
+#include "rc4.hpp"
+
+// Sample stream -> frames: preamble detection, EQ training and symbol reading.
+// Every instance is independent, any number of them can run on separate threads.
+class FrameReceiver {
+public:
+    virtual ~FrameReceiver() = default;
+
+    // Process a buffer of samples. The first sample is at <timecode> (sample
+    // counter), and at <timestamp> (us). on_frame() is called for every
+    // complete frame, on_abort() (optional) for every frame abandoned as
+    // hopeless before it was complete, with what the abort amounts to (NO_SYNC:
+    // before the preamble was confirmed, REJECTED: after). Returns true if the noise and DC
+    // statistics were updated (no frame in this buffer).
+    virtual bool process(const std::complex<int8_t>* samples, size_t sample_count,
+                         uint64_t timecode, uint64_t timestamp,
+                         const std::function<void(Frame*)>& on_frame,
+                         const std::function<void(const Frame*, FrameOutcome)>& on_abort) = 0;
+
+    virtual std::complex<float> dc_offset() const = 0;
+    virtual float noise_energy() const = 0;
+    virtual int samples_per_symbol() const = 0;
+
+    // match threshold of the preamble search (see ThresholdController)
+    virtual float preamble_threshold(TransponderProtocol protocol) const = 0;
+    virtual void set_preamble_threshold(TransponderProtocol protocol, float threshold) = 0;
+};
+
+// The receiver of a sample rate. The DSP is compiled for each supported
+// samples per symbol, the rate is picked per buffer, not per sample.
+template<int SPS>
+class SpsFrameReceiver final : public FrameReceiver {
+    enum FrameParseMode { FRAME_SEEK, FRAME_WAIT, FRAME_FOUND } frame_parse_mode = FRAME_SEEK;
+    int pending_trail = 0; // symbols left to wait before the centered EQ window is full
+    FrameDetector<SPS> frame_detector;
+    SymbolReader<SPS> symbol_reader;
+    Frame frame;
+
+public:
+    bool process(const std::complex<int8_t>* samples, size_t sample_count,
+                 uint64_t timecode, uint64_t timestamp,
+                 const std::function<void(Frame*)>& on_frame,
+                 const std::function<void(const Frame*, FrameOutcome)>& on_abort) override;
+
+    std::complex<float> dc_offset() const override { return frame_detector.dc_offset(); }
+    float noise_energy() const override { return frame_detector.noise_energy(); }
+    int samples_per_symbol() const override { return SPS; }
+
+    float preamble_threshold(TransponderProtocol protocol) const override {
+        return frame_detector.preamble_threshold(protocol);
+    }
+    void set_preamble_threshold(TransponderProtocol protocol, float threshold) override {
+        frame_detector.set_preamble_threshold(protocol, threshold);
+    }
+};
+
+// nullptr if <samples_per_symbol> is not supported (see supported_samples_per_symbol())
+std::unique_ptr<FrameReceiver> make_frame_receiver(int samples_per_symbol);
+
+// payload of a frame which passed its protocol's checks
+struct DecodedFrame {
+    TransponderProtocol protocol;
+    uint64_t timestamp; // us
+    uint64_t timecode;  // sample counter
+    float rssi;
+    uint64_t message;   // OpenStint: 24-bit message, RC3: transponder id, RC4: payload
+    uint8_t status_code; // RC3 only
+};
+
+// CRC/validity checks only, no state: thread-safe
+bool decode_frame(Frame* frame, DecodedFrame* decoded);
+
+// Decoded frames -> detections of known transponders. Keeps the state which
+// depends on the order of frames (AMBRc blacklist, RC4 learning), so frames
+// have to be routed in timecode order.
+class DetectionRouter {
+    PassingDetector& passing_detector;
+    RC4Registry& rc4_registry;
+    RC4Trainer* rc4_trainer;
+    AmbRcBlacklist ambrc_blacklist;
+
+public:
+    // rc4_trainer is optional (nullptr: no learning)
+    DetectionRouter(PassingDetector& passing_detector, RC4Registry& rc4_registry, RC4Trainer* rc4_trainer);
+
+    // returns whether the frame counts as processed in the rx statistics
+    bool route(const DecodedFrame& decoded);
+};
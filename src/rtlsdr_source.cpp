@@ -0,0 +1,207 @@
+#include "rtlsdr_source.hpp"
+
+#include <atomic>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "logger.hpp"
+
+#include <rtl-sdr.h>
+
+// number of raw bytes (2 per IQ sample) read per chunk, matching the RTL-SDR read buffer
+static const size_t CHUNK_BYTES = 2*16384;
+
+class RtlSdrSource : public SampleSource {
+    std::string serial; // empty: first device
+    rtlsdr_dev_t* device = nullptr;
+    std::thread rx_thread;
+    std::atomic<bool> running = false;
+    ChunkHandler handler;
+    uint64_t timecode = 0;
+
+    // Conversion buffer: RTL-SDR provides uint8_t, the pipelines expect int8_t
+    std::vector<std::complex<int8_t>> conversion_buffer = std::vector<std::complex<int8_t>>(CHUNK_BYTES / 2);
+
+    // rtlsdr callback invoked for each block of data; ctx is the source
+    static void rx_callback(unsigned char* buf, uint32_t len, void* ctx) {
+        RtlSdrSource* source = static_cast<RtlSdrSource*>(ctx);
+        const uint32_t sample_count = len / 2;
+        if (source->conversion_buffer.size() < sample_count) {
+            source->conversion_buffer.resize(sample_count);
+        }
+        cu8_to_cs8(buf, source->conversion_buffer.data(), sample_count);
+        source->handler({ source->conversion_buffer.data(), sample_count, source->timecode, 0 });
+        source->timecode += sample_count;
+    }
+
+public:
+    explicit RtlSdrSource(std::string _serial) : serial(std::move(_serial)) {}
+    ~RtlSdrSource() override;
+
+    bool open(const RtlSettings& settings);
+
+    std::string name() const override {
+        return serial.empty() ? "RTL-SDR" : std::format("RTL-SDR {}", serial);
+    }
+    SampleFormat format() const override { return SampleFormat::CU8; }
+    bool start(ChunkHandler handler) override;
+    void stop() override;
+    bool streaming() const override { return running; }
+};
+
+// open and set up the radio; false on failure (a half-opened device is closed by the destructor)
+bool RtlSdrSource::open(const RtlSettings& settings) {
+    int result;
+
+    // find device
+    int device_count = rtlsdr_get_device_count();
+    if (device_count == 0) {
+        std::fprintf(stderr, "No RTL-SDR devices found.\n");
+        return false;
+    }
+
+    int device_index = 0;
+    if (!serial.empty()) {
+        device_index = rtlsdr_get_index_by_serial(serial.c_str());
+        if (device_index < 0) {
+            std::fprintf(stderr, "RTL-SDR with serial '%s' not found.\n", serial.c_str());
+            return false;
+        }
+    }
+
+    // open device
+    result = rtlsdr_open(&device, device_index);
+    if (result != 0 || device == nullptr) {
+        std::fprintf(stderr, "rtlsdr_open() failed: %d\n", result);
+        return false;
+    }
+
+    bool is_v4 = false;
+    char manufact[256] = {0}, product[256] = {0}, sn[256] = {0};
+    // 1. Attempt to retrieve USB strings.
+    // Note: On Windows, calling rtlsdr_get_usb_strings(device, ...) after rtlsdr_open
+    // is more reliable than using the device index before opening.
+    if (rtlsdr_get_usb_strings(device, manufact, product, sn) == 0) {
+        is_v4 = (std::strstr(product, "V4") != nullptr);
+        std::printf("RTL-SDR: %s (SN: %s)\n", product, sn);
+    } else {
+        // Fallback: If USB string retrieval fails, identify by device index name
+        const char* name = rtlsdr_get_device_name(device_index);
+        std::printf("RTL-SDR: %s\n", name);
+    }
+
+    // 2. Hardware-level verification via Tuner Type.
+    // RTL-SDR Blog V4 uses the R828D tuner, whereas V3 typically uses R820T2.
+    // This is the most robust detection method if USB descriptors are blocked by drivers.
+    if (!is_v4) {
+        enum rtlsdr_tuner tuner_type = rtlsdr_get_tuner_type(device);
+        is_v4 = (tuner_type == RTLSDR_TUNER_R828D);
+        if (is_v4) {
+            std::printf("RTL-SDR Blog V4 detected via Tuner Type (R828D)\n");
+        }
+    }
+
+    // RTL-SDR Blog V4 features an integrated HF upconverter (Frequency Upconverter/Mixer)
+    // allowing native HF reception without direct sampling.
+    if (is_v4) {
+        std::printf("V4 Mode: Native HF reception enabled.\n");
+    } else {
+        // Older dongles (V3 and generic) require Direct Sampling Mode (Q-branch) for HF.
+        std::fprintf(stderr, "Non-V4 dongle detected — enabling direct sampling (Q-branch)\n");
+        result = rtlsdr_set_direct_sampling(device, 2);
+        if (result != 0) {
+            std::fprintf(stderr, "rtlsdr_set_direct_sampling() failed: %d\n", result);
+            return false;
+        }
+    }
+
+    // set center frequency
+    result = rtlsdr_set_center_freq(device, settings.freq_hz);
+    if (result != 0) {
+        std::fprintf(stderr, "rtlsdr_set_center_freq() failed: %d\n", result);
+        return false;
+    }
+
+    // set sample rate (2.5 MSPS with SAMPLES_PER_SYMBOL=2)
+    result = rtlsdr_set_sample_rate(device, settings.sample_rate);
+    if (result != 0) {
+        std::fprintf(stderr, "rtlsdr_set_sample_rate() failed: %d\n", result);
+        return false;
+    }
+
+    // set IF filter bandwidth to 2.0 MHz - to be refined
+    result = rtlsdr_set_tuner_bandwidth(device, 2000000);
+    if (result != 0) {
+        std::fprintf(stderr, "rtlsdr_set_tuner_bandwidth() failed: %d\n", result);
+    }
+
+    // set manual gain mode and tuner gain
+    rtlsdr_set_tuner_gain_mode(device, 1);
+    if (is_v4) {
+        result = rtlsdr_set_tuner_gain(device, settings.gain_tenths_db);
+        if (result != 0) {
+            std::fprintf(stderr, "rtlsdr_set_tuner_gain() failed: %d\n", result);
+        } else {
+            int actual = rtlsdr_get_tuner_gain(device);
+            std::fprintf(stderr, "Tuner gain set to %.1f dB\n", actual / 10.0);
+        }
+    } else {
+        std::fprintf(stderr, "Tuner gain not applicable in direct sampling mode\n");
+    }
+
+    // enable bias-tee if requested
+    result = rtlsdr_set_bias_tee(device, settings.bias_tee ? 1 : 0);
+    if (result != 0) {
+        std::fprintf(stderr, "Warning: Failed to set bias-tee (may not be supported)\n");
+    }
+
+    // reset buffer to clear stale data
+    rtlsdr_reset_buffer(device);
+
+    return true;
+}
+
+RtlSdrSource::~RtlSdrSource() {
+    stop();
+    if (device != nullptr) {
+        rtlsdr_set_bias_tee(device, 0);
+        rtlsdr_close(device);
+        device = nullptr;
+    }
+}
+
+bool RtlSdrSource::start(ChunkHandler _handler) {
+    stop();
+    handler = std::move(_handler);
+    running = true;
+    rx_thread = std::thread([this]() {
+        int result = rtlsdr_read_async(device, rx_callback, this, 12, CHUNK_BYTES);
+        if (result != 0) {
+            log_err("rtlsdr_read_async() failed on {}: {}", name(), result);
+        }
+        running = false;
+    });
+    return true;
+}
+
+void RtlSdrSource::stop() {
+    // ensure async reading is cancelled
+    if (rx_thread.joinable()) {
+        rtlsdr_cancel_async(device);
+        rx_thread.join();
+    }
+    running = false;
+}
+
+std::unique_ptr<SampleSource> make_rtlsdr_source(const std::string& serial, const RtlSettings& settings) {
+    auto source = std::make_unique<RtlSdrSource>(serial);
+    if (!source->open(settings)) {
+        return nullptr;
+    }
+    return source;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "sample_source.hpp"
+
+// A local RTL-SDR (empty serial: the first one found), opened and tuned;
+// nullptr on failure.
+std::unique_ptr<SampleSource> make_rtlsdr_source(const std::string& serial, const RtlSettings& settings);
@@ -0,0 +1,77 @@
+#include "sample_clock.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void SampleClock::update(uint64_t timecode, uint64_t host_time) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (suspect_buffers > 0) {
+        return; // lost samples or a host delay: not a point of the model either way
+    }
+
+    const double x = static_cast<double>(timecode);
+    const double y = static_cast<double>(host_time) - nominal_us(x);
+    if (fit.count > 0 && std::abs(y - fit.predict(x)) > SAMPLE_CLOCK_RESET_US) {
+        fit = LinearFit(); // the counter and the host clock parted ways; start over
+    }
+    fit.add(x, y, SAMPLE_CLOCK_WINDOW);
+}
+
+uint64_t SampleClock::missing_samples(uint64_t timecode, uint64_t host_time, uint64_t buffer_size) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (fit.count < SAMPLE_CLOCK_GAP_WARMUP || buffer_size == 0) {
+        return 0;
+    }
+    const double x = static_cast<double>(timecode);
+    const double residual = static_cast<double>(host_time) - nominal_us(x) - fit.predict(x);
+    const double jitter = std::sqrt(fit.residual_power);
+
+    // the residual of a buffer behind a lost one scatters around the lost
+    // length: a whole buffer is allowed the jitter (up to SAMPLE_CLOCK_GAP_SLACK),
+    // anything shorter is a delay
+    uint64_t buffers = 0;
+    if (residual > SAMPLE_CLOCK_GAP_JITTER * jitter) {
+        const double buffer_us = nominal_us(static_cast<double>(buffer_size));
+        const double slack = std::min(SAMPLE_CLOCK_GAP_JITTER * jitter, SAMPLE_CLOCK_GAP_SLACK * buffer_us);
+        buffers = static_cast<uint64_t>(std::floor((residual + slack) / buffer_us));
+    }
+
+    if (buffers == 0) {
+        suspect_buffers = 0; // on time (again): a host delay, if anything
+        return 0;
+    }
+    if (buffers != suspect_buffers) {
+        // a new suspect, or the offset changed (buffers queued up behind a
+        // delay are processed in a burst): wait for it to settle
+        suspect_buffers = buffers;
+        suspect_confirmations = 0;
+        return 0;
+    }
+    if (++suspect_confirmations < SAMPLE_CLOCK_GAP_CONFIRM) {
+        return 0;
+    }
+    suspect_buffers = 0;
+    return buffers * buffer_size;
+}
+
+uint64_t SampleClock::timestamp(uint64_t timecode) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const double x = static_cast<double>(timecode);
+    const double t = nominal_us(x) + fit.predict(x);
+    return t > 0.0 ? static_cast<uint64_t>(std::llround(t)) : 0;
+}
+
+float SampleClock::ppm() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // slope: host us per sample, above the nominal; a fast sample clock takes less host time
+    return static_cast<float>(-fit.slope() * sample_rate);
+}
+
+float SampleClock::jitter() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<float>(std::sqrt(fit.residual_power));
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include "linear_fit.hpp"
+
+#define SAMPLE_CLOCK_WINDOW 2048       // buffers (~7-30 s, depending on the radio)
+#define SAMPLE_CLOCK_RESET_US 20000    // a buffer this far off the model restarts it (ie. clock step)
+#define SAMPLE_CLOCK_GAP_JITTER 4       // a gap must stand out of the jitter this many times
+#define SAMPLE_CLOCK_GAP_WARMUP 64      // buffers before gaps are detected
+#define SAMPLE_CLOCK_GAP_SLACK 0.25     // of a buffer, at most: jitter allowed below a whole lost buffer
+#define SAMPLE_CLOCK_GAP_CONFIRM 2      // buffers after a late one which must be just as late
+
+// Host time of the samples, from the sample counter.
+//
+// Buffers are timestamped when they get processed, with the jitter of the
+// scheduler and the USB stack (see docs/timing-accuracy.md). The sample
+// counter has no jitter, but runs on the radio's crystal. An exponentially
+// weighted linear regression over the (timecode, host time) pairs of the
+// buffers models the offset and the rate of the sample clock against the
+// host clock; timestamps come from the counter through the model.
+//
+// A lost transfer shifts every later buffer by its length, for good; a host
+// delay (ie. a scheduler hiccup) makes a buffer late, but the next ones are on
+// time again. A late buffer is only a suspect: the loss is reported once
+// SAMPLE_CLOCK_GAP_CONFIRM more buffers confirmed the offset. Suspects are
+// kept out of the model until then.
+class SampleClock {
+    const uint32_t sample_rate;
+    LinearFit fit; // x: timecode (samples), y: host time - nominal time of the timecode (us)
+    uint64_t suspect_buffers = 0; // whole buffers the pending suspect is behind the model (0: none)
+    uint32_t suspect_confirmations = 0;
+    mutable std::mutex mutex;
+
+    double nominal_us(double timecode) const { return timecode * 1e6 / sample_rate; }
+
+public:
+    explicit SampleClock(uint32_t _sample_rate) : sample_rate(_sample_rate) {}
+
+    // the buffer ending at <timecode> was processed at <host_time> (us)
+    void update(uint64_t timecode, uint64_t host_time);
+    // Samples lost before the buffer ending at <timecode>, processed at
+    // <host_time>: more host time has passed than the counter shows. Transfers
+    // are lost whole: the estimate is the number of whole buffers the lateness
+    // makes up (rounded down), reported once confirmed by the next buffers.
+    // Call for every buffer, before update().
+    uint64_t missing_samples(uint64_t timecode, uint64_t host_time, uint64_t buffer_size);
+    // host time (us) of the sample at <timecode>
+    uint64_t timestamp(uint64_t timecode) const;
+
+    // rate error of the sample clock against the host clock
+    float ppm() const;
+    // rms deviation of the buffer times from the model (us)
+    float jitter() const;
+};
@@ -0,0 +1,419 @@
+#include "sample_source.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "commons.hpp"
+#include "logger.hpp"
+
+// bytes (2 per IQ sample) per chunk, as the RTL-SDR async reads deliver them
+static const size_t CHUNK_BYTES = 32768;
+
+#define REPORT_PERIOD_MS 100
+#define LOST_SOURCE_MS 2000          // a radio without samples for this long is lost
+#define FLUSH_MS 500                 // at the end of a capture, for the pipelines to catch up
+#define RTL_TCP_HEADER_BYTES 12      // "RTL0", tuner type, gain count (big-endian)
+#define RTL_TCP_TUNER_R828D 6        // RTL-SDR Blog V4: native HF, no direct sampling
+#define RTL_TCP_MAX_SAMPLE_RATE 3200000
+
+using namespace std::chrono;
+
+static int64_t steady_ms() {
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void cu8_to_cs8(const uint8_t* in, std::complex<int8_t>* out, size_t sample_count) {
+    // RTL-SDR: 0-255, DC at 128
+    for (size_t i = 0; i < sample_count; ++i) {
+        out[i] = std::complex<int8_t>(
+            static_cast<int8_t>(in[2 * i]     - 128),
+            static_cast<int8_t>(in[2 * i + 1] - 128)
+        );
+    }
+}
+
+PulledSampleSource::PulledSampleSource(double _sample_rate, bool _paced)
+    : sample_rate(_sample_rate), paced(_paced) {}
+
+void PulledSampleSource::deliver(const uint8_t* data, size_t sample_count, SampleFormat format, const ChunkHandler& handler) {
+    SampleChunk chunk = { nullptr, sample_count, timecode, 0 };
+    if (format == SampleFormat::CS8) {
+        chunk.samples = reinterpret_cast<const std::complex<int8_t>*>(data);
+    } else {
+        if (conversion_buffer.size() < sample_count) {
+            conversion_buffer.resize(sample_count);
+        }
+        cu8_to_cs8(data, conversion_buffer.data(), sample_count);
+        chunk.samples = conversion_buffer.data();
+    }
+    timecode += sample_count;
+    handler(chunk);
+}
+
+bool PulledSampleSource::start(ChunkHandler handler) {
+    stop();
+    if (!open()) {
+        return false;
+    }
+    stop_requested = false;
+    running = true;
+    thread = std::thread([this, handler = std::move(handler)]() {
+        // pace on the sample counter, not on the time the chunks took
+        const steady_clock::time_point started = steady_clock::now();
+        const uint64_t first = timecode;
+        while (!stop_requested && pull(handler)) {
+            if (paced) {
+                std::this_thread::sleep_until(started + duration_cast<steady_clock::duration>(
+                    duration<double>((timecode - first) / sample_rate)));
+            }
+        }
+        running = false;
+    });
+    return true;
+}
+
+void PulledSampleSource::stop() {
+    stop_requested = true;
+    if (thread.joinable()) {
+        interrupt();
+        thread.join();
+    }
+    running = false;
+}
+
+// ---------------------------------------------------------------------------
+
+CaptureFileSource::CaptureFileSource(std::vector<std::string> _files, SampleFormat format, double sample_rate, bool paced)
+    : PulledSampleSource(sample_rate, paced), files(std::move(_files)), sample_format(format) {}
+
+std::string CaptureFileSource::name() const {
+    return files.size() == 1 ? std::format("'{}'", files.front()) : std::format("{} captures", files.size());
+}
+
+bool CaptureFileSource::pull(const ChunkHandler& handler) {
+    while (true) {
+        if (!reading) {
+            if (next_file >= files.size()) {
+                return false;
+            }
+            const std::string& file = files[next_file++];
+            reading_stdin = (file == "-");
+            if (reading_stdin) {
+#ifdef _WIN32
+                _setmode(_fileno(stdin), _O_BINARY);
+#endif
+                read_buffer.resize(CHUNK_BYTES);
+            } else if (mapped.open(file)) {
+                mapped.advise_sequential();
+                offset = 0;
+            } else {
+                log_err("Failed to open '{}'", file);
+                continue;
+            }
+            log_out("Replaying '{}'", reading_stdin ? "<stdin>" : file);
+            reading = true;
+        }
+
+        if (reading_stdin) {
+            // each IQ sample is two bytes; a trailing odd byte is dropped
+            const size_t n_read = std::fread(read_buffer.data(), 1, CHUNK_BYTES, stdin);
+            if (n_read >= 2) {
+                deliver(read_buffer.data(), n_read / 2, sample_format, handler);
+                return true;
+            }
+        } else {
+            // the chunks stay as small as the live ones: the detector's noise
+            // and DC statistics are evaluated per chunk
+            const size_t size = (mapped.size() / 2) * 2;
+            if (offset < size) {
+                const size_t byte_count = std::min(CHUNK_BYTES, size - offset);
+                deliver(mapped.data() + offset, byte_count / 2, sample_format, handler);
+                offset += byte_count;
+                return true;
+            }
+            mapped.close();
+        }
+        reading = false;
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+static bool always_on(const GeneratorConfig& config) {
+    return std::any_of(config.transponders.begin(), config.transponders.end(), [](const GeneratedTransponder& t) {
+        return t.crossing_duration <= 0.0;
+    });
+}
+
+GeneratorSource::GeneratorSource(GeneratorConfig config, double duration, bool paced)
+    : PulledSampleSource(SYMBOL_RATE * config.samples_per_symbol, paced),
+      generator(config),
+      buffer(CHUNK_BYTES / 2) {
+    // without a length, transponders which never leave the field are rendered until stop()
+    total = (duration > 0.0) ? static_cast<uint64_t>(duration * generator.rate()) : UINT64_MAX;
+    endless = (duration <= 0.0) && always_on(config);
+}
+
+bool GeneratorSource::pull(const ChunkHandler& handler) {
+    if (timecode >= total || (!endless && generator.finished())) {
+        return false;
+    }
+    const size_t n = static_cast<size_t>(std::min<uint64_t>(buffer.size(), total - timecode));
+    generator.generate_cs8(buffer.data(), n);
+    deliver(reinterpret_cast<const uint8_t*>(buffer.data()), n, SampleFormat::CS8, handler);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+
+static uint32_t read_be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+RtlTcpSource::RtlTcpSource(std::string _host, uint16_t _port, const RtlSettings& _settings)
+    : PulledSampleSource(_settings.sample_rate, false), // paced by the radio
+      host(std::move(_host)), port(_port), settings(_settings), read_buffer(CHUNK_BYTES) {}
+
+std::string RtlTcpSource::name() const {
+    return std::format("rtl_tcp {}:{}", host, port);
+}
+
+bool RtlTcpSource::command(uint8_t code, uint32_t parameter) {
+    // a byte of command, a big-endian parameter
+    const uint8_t message[5] = {
+        code,
+        static_cast<uint8_t>(parameter >> 24), static_cast<uint8_t>(parameter >> 16),
+        static_cast<uint8_t>(parameter >> 8), static_cast<uint8_t>(parameter)
+    };
+    return socket.send_all(message, sizeof(message));
+}
+
+bool RtlTcpSource::open() {
+    if (settings.sample_rate > RTL_TCP_MAX_SAMPLE_RATE) {
+        log_err("rtl_tcp: {} Hz is beyond the RTL-SDR's sample rates (use 2 samples per symbol)", settings.sample_rate);
+        return false;
+    }
+    if (!socket.connect(host, port)) {
+        log_err("rtl_tcp: failed to connect to {}:{}", host, port);
+        return false;
+    }
+    uint8_t header[RTL_TCP_HEADER_BYTES];
+    if (!socket.recv_all(header, sizeof(header)) || std::string_view(reinterpret_cast<const char*>(header), 4) != "RTL0") {
+        log_err("rtl_tcp: {}:{} is not an rtl_tcp server", host, port);
+        socket.close();
+        return false;
+    }
+    const uint32_t tuner = read_be32(header + 4);
+    const bool is_v4 = (tuner == RTL_TCP_TUNER_R828D);
+    log_out("rtl_tcp: connected to {}:{}, tuner type {}{}", host, port, tuner, is_v4 ? " (R828D, native HF)" : "");
+
+    // as the local radios are set up (see rtlsdr_source.cpp); older dongles
+    // need direct sampling (Q-branch) for HF, where the tuner gain does not apply
+    bool ok = true;
+    if (!is_v4) {
+        ok &= command(0x09, 2);                             // direct sampling
+    }
+    ok &= command(0x01, static_cast<uint32_t>(settings.freq_hz)); // center frequency
+    ok &= command(0x02, settings.sample_rate);               // sample rate
+    ok &= command(0x03, 1);                                  // manual gain mode
+    if (is_v4) {
+        ok &= command(0x04, static_cast<uint32_t>(settings.gain_tenths_db)); // tuner gain
+    }
+    ok &= command(0x0e, settings.bias_tee ? 1 : 0);          // bias-tee
+    if (!ok) {
+        log_err("rtl_tcp: failed to set up {}:{}", host, port);
+        socket.close();
+    }
+    return ok;
+}
+
+void RtlTcpSource::interrupt() {
+    socket.shutdown();
+}
+
+bool RtlTcpSource::pull(const ChunkHandler& handler) {
+    if (!socket.recv_all(read_buffer.data(), read_buffer.size())) {
+        log_err("rtl_tcp: connection to {}:{} lost", host, port);
+        socket.close();
+        return false;
+    }
+    deliver(read_buffer.data(), read_buffer.size() / 2, SampleFormat::CU8, handler);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+
+bool parse_source_arguments(int& i, const int argc, const std::string& arg, char** argv, SourceOptions* options) {
+    if (arg == "-d" && i + 1 < argc) {
+        options->devices.push_back(argv[++i]);
+    } else if (arg == "-c" && i + 1 < argc) {
+        options->capture_files.push_back(argv[++i]);
+    } else if (arg == "-G" && i + 1 < argc) {
+        GeneratedTransponder t;
+        if (!parse_transponder_spec(argv[++i], &t)) {
+            log_err("Invalid transponder: {}", argv[i]);
+            std::exit(EXIT_FAILURE);
+        }
+        options->generated.push_back(t);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::vector<LoopSource> create_sources(const SourceOptions& options,
+                                       SampleFormat capture_format,
+                                       const RtlSettings& rtl_tcp_settings,
+                                       const std::function<std::unique_ptr<SampleSource>(const std::string& serial)>& open_device,
+                                       std::vector<size_t>* loop_inputs) {
+    std::vector<LoopSource> sources;
+    loop_inputs->clear();
+
+    // captures or the generator instead of the radios: loop 0
+    if (!options.capture_files.empty() || !options.generated.empty()) {
+        loop_inputs->push_back(1);
+        if (!options.capture_files.empty()) {
+            sources.push_back({ std::make_unique<CaptureFileSource>(options.capture_files, capture_format,
+                SYMBOL_RATE * options.samples_per_symbol, !offline_mode()) });
+        } else {
+            GeneratorConfig config;
+            config.transponders = options.generated;
+            config.samples_per_symbol = options.samples_per_symbol;
+            sources.push_back({ std::make_unique<GeneratorSource>(config, 0.0, !offline_mode()) });
+        }
+        return sources;
+    }
+
+    // a loop per -d, an input per '+'-joined device (antenna diversity);
+    // without -d, the first radio found
+    std::vector<std::string> devices = options.devices;
+    if (devices.empty()) {
+        devices.push_back("");
+    }
+    for (const std::string& loop_devices : devices) {
+        size_t begin = 0;
+        loop_inputs->push_back(0);
+        do {
+            size_t end = loop_devices.find('+', begin);
+            end = (end == std::string::npos) ? loop_devices.size() : end;
+            const std::string device = loop_devices.substr(begin, end - begin);
+            begin = end + 1;
+
+            std::unique_ptr<SampleSource> source;
+            if (device.starts_with("tcp://")) {
+                // tcp://host[:port]
+                std::string host = device.substr(6);
+                uint16_t port = RTL_TCP_DEFAULT_PORT;
+                const size_t colon = host.rfind(':');
+                if (colon != std::string::npos && host.find(']', colon) == std::string::npos) {
+                    port = static_cast<uint16_t>(std::atoi(host.c_str() + colon + 1));
+                    host.resize(colon);
+                }
+                if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+                    host = host.substr(1, host.size() - 2); // [ipv6]
+                }
+                source = std::make_unique<RtlTcpSource>(host, port, rtl_tcp_settings);
+            } else {
+                source = open_device(device);
+                if (!source) {
+                    sources.clear();
+                    return sources;
+                }
+            }
+            sources.push_back({ std::move(source), loop_inputs->size() - 1, loop_inputs->back()++ });
+        } while (begin <= loop_devices.size());
+    }
+    return sources;
+}
+
+bool stream_sources(std::vector<LoopSource>& sources, const std::atomic<bool>& do_exit) {
+    // lost radio detection
+    std::vector<std::atomic<int64_t>> last_chunk_ms(sources.size());
+
+    bool ok = true;
+    for (size_t index = 0; index < sources.size() && ok; index++) {
+        LoopSource& s = sources[index];
+        last_chunk_ms[index] = steady_ms();
+        // a DSP thread per source
+        ok = s.source->start([index, loop = s.loop, input = s.input, &last_chunk_ms](const SampleChunk& chunk) {
+            static thread_local bool pinned = false;
+            if (!pinned) {
+                pin_thread_to_core(index);
+                pinned = true;
+            }
+            last_chunk_ms[index] = steady_ms();
+            detect_frames(chunk.samples, chunk.sample_count, loop, input);
+        });
+        if (!ok) {
+            log_err("Failed to start {}", s.source->name());
+        }
+    }
+    if (ok) {
+        log_err("Streaming {} source(s)... stop with Ctrl-C", sources.size());
+    }
+
+    bool finished = false;
+    while (ok && !finished && !do_exit) {
+        std::this_thread::sleep_for(milliseconds(REPORT_PERIOD_MS));
+        report_detections();
+
+        // a radio may stall silently if it is unplugged
+        const int64_t now_ms = steady_ms();
+        for (size_t index = 0; index < sources.size(); index++) {
+            const SampleSource& source = *sources[index].source;
+            if (source.finite()) {
+                finished |= !source.streaming();
+            } else if (!source.streaming()) {
+                log_err("{} stopped streaming on loop {}", source.name(), sources[index].loop);
+                ok = false;
+            } else if (now_ms - last_chunk_ms[index] > LOST_SOURCE_MS) {
+                log_err("No samples for {} s from {} on loop {} — device lost?", LOST_SOURCE_MS / 1000, source.name(), sources[index].loop);
+                ok = false;
+            }
+        }
+    }
+
+    for (LoopSource& s : sources) {
+        s.source->stop();
+    }
+    if (finished) {
+        // give the pipelines a moment to flush, then emit the final report
+        std::this_thread::sleep_for(milliseconds(FLUSH_MS));
+        report_detections();
+    }
+    return ok;
+}
+
+void stream_source_offline(SampleSource& source, uint32_t sample_rate, const std::atomic<bool>& do_exit) {
+    // report as often as the live loops would, in virtual time
+    const size_t report_samples = sample_rate / 10;
+
+    uint64_t next_report = report_samples;
+    auto handler = [&next_report, report_samples](const SampleChunk& chunk) {
+        detect_frames(chunk.samples, chunk.sample_count); // loop 0, input 0
+        if (chunk.timecode + chunk.sample_count >= next_report) {
+            report_detections();
+            next_report += report_samples;
+        }
+    };
+    while (!do_exit && source.pull(handler)) {
+    }
+
+    // let the passings in progress time out, as a live decoder would after
+    // the last transponder left the loop
+    for (int i = 0; i < 10 && !do_exit; i++) {
+        skip_samples(report_samples);
+        report_detections();
+    }
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame.hpp"
+#include "generator.hpp"
+#include "mapped_file.hpp"
+#include "tcp_socket.hpp"
+
+#define RTL_TCP_DEFAULT_PORT 1234
+
+enum class SampleFormat {
+    CS8, // signed 8-bit I/Q: HackRF, hackrf_transfer
+    CU8, // unsigned 8-bit I/Q, DC at 128: RTL-SDR, rtl_sdr, rtl_tcp
+};
+
+// a block of samples; converted to CS8, whatever the source delivers
+struct SampleChunk {
+    const std::complex<int8_t>* samples;
+    size_t sample_count;
+    uint64_t timecode;         // index of the first sample, counted by the source
+    uint64_t native_timestamp; // us, on the device's own clock; 0: it has none (the pipelines time the chunks on arrival)
+};
+typedef std::function<void(const SampleChunk&)> ChunkHandler;
+
+void cu8_to_cs8(const uint8_t* in, std::complex<int8_t>* out, size_t sample_count);
+
+// Where the samples of an input come from: a radio, a capture, the generator
+// or a radio on the network.
+//
+// Between start() and stop(), a source pushes chunks to the handler on a
+// thread of its own (the DSP thread of the input). Sources which can also be
+// read on the caller's thread (pull()) can be processed offline (-x).
+class SampleSource {
+public:
+    virtual ~SampleSource() = default;
+
+    virtual std::string name() const = 0;
+    // as delivered by the device or the file
+    virtual SampleFormat format() const = 0;
+    // captures and the generator come to an end, radios do not
+    virtual bool finite() const { return false; }
+
+    virtual bool start(ChunkHandler handler) = 0;
+    virtual void stop() = 0;
+    // false once the source stopped on its own (end of the capture, device or connection lost)
+    virtual bool streaming() const = 0;
+    // the next chunk, on the calling thread; false at the end of the stream
+    virtual bool pull(const ChunkHandler& /*handler*/) { return false; }
+};
+
+// A source read by pull(); start() calls it on a thread of its own, paced to
+// the sample rate (as a radio would deliver the samples) if <paced>.
+// Derived classes call stop() in their destructor.
+class PulledSampleSource : public SampleSource {
+    std::thread thread;
+    std::atomic<bool> running = false;
+    std::atomic<bool> stop_requested = false;
+    std::vector<std::complex<int8_t>> conversion_buffer;
+
+protected:
+    const double sample_rate;
+    const bool paced;
+    uint64_t timecode = 0;
+
+    PulledSampleSource(double sample_rate, bool paced);
+    // before the thread starts
+    virtual bool open() { return true; }
+    // wake up a pull() blocked on I/O, from stop()
+    virtual void interrupt() {}
+    // converts and counts the samples, then hands them to <handler>
+    void deliver(const uint8_t* data, size_t sample_count, SampleFormat format, const ChunkHandler& handler);
+
+public:
+    bool start(ChunkHandler handler) override;
+    void stop() override;
+    bool streaming() const override { return running; }
+};
+
+// Raw 8-bit I/Q capture files, one after the other ("-": stdin). Files are
+// memory-mapped; CS8 chunks point straight into the mapping.
+class CaptureFileSource : public PulledSampleSource {
+    std::vector<std::string> files;
+    SampleFormat sample_format;
+    size_t next_file = 0;
+    bool reading = false;
+    bool reading_stdin = false;
+    MappedFile mapped;
+    size_t offset = 0;
+    std::vector<uint8_t> read_buffer;
+
+public:
+    CaptureFileSource(std::vector<std::string> files, SampleFormat format, double sample_rate, bool paced);
+    ~CaptureFileSource() override { stop(); }
+
+    std::string name() const override;
+    SampleFormat format() const override { return sample_format; }
+    bool finite() const override { return true; }
+    bool pull(const ChunkHandler& handler) override;
+};
+
+// Synthetic transponders (see generator.hpp), for tests without a radio.
+// Runs for <duration> seconds if given, else until every transponder left
+// the field (or until stop(), if some never do).
+class GeneratorSource : public PulledSampleSource {
+    SignalGenerator generator;
+    uint64_t total;
+    bool endless;
+    std::vector<std::complex<int8_t>> buffer;
+
+public:
+    GeneratorSource(GeneratorConfig config, double duration, bool paced);
+    ~GeneratorSource() override { stop(); }
+
+    std::string name() const override { return "generator"; }
+    SampleFormat format() const override { return SampleFormat::CS8; }
+    bool finite() const override { return !endless; }
+    bool pull(const ChunkHandler& handler) override;
+};
+
+// tuning of an RTL-SDR, local or behind rtl_tcp
+struct RtlSettings {
+    uint64_t freq_hz = 5000000;
+    uint32_t sample_rate = SAMPLE_RATE;
+    int gain_tenths_db = 200;
+    bool bias_tee = false;
+};
+
+// An RTL-SDR on an other host, served by rtl_tcp: the radio can sit on a
+// small USB host next to the loop, the decoding on a stronger machine. The
+// server paces the stream.
+class RtlTcpSource : public PulledSampleSource {
+    std::string host;
+    uint16_t port;
+    RtlSettings settings;
+    TcpSocket socket;
+    std::vector<uint8_t> read_buffer;
+
+    bool command(uint8_t code, uint32_t parameter);
+
+protected:
+    bool open() override;
+    void interrupt() override;
+
+public:
+    RtlTcpSource(std::string host, uint16_t port, const RtlSettings& settings);
+    ~RtlTcpSource() override { stop(); }
+
+    std::string name() const override;
+    SampleFormat format() const override { return SampleFormat::CU8; }
+    bool pull(const ChunkHandler& handler) override;
+};
+
+// -d, -c and -G of the radio binaries
+struct SourceOptions {
+    std::vector<std::string> devices;             // -d: a loop each, '+' joins the inputs of a loop
+    std::vector<std::string> capture_files;       // -c
+    std::vector<GeneratedTransponder> generated;  // -G
+    int samples_per_symbol = SAMPLES_PER_SYMBOL;  // of the captures and the generator
+};
+bool parse_source_arguments(int& i, const int argc, const std::string& arg, char** argv, SourceOptions* options);
+
+// a source feeding an input of a loop
+struct LoopSource {
+    std::unique_ptr<SampleSource> source;
+    size_t loop = 0;
+    size_t input = 0;
+};
+
+// The inputs of the loops: the captures (<capture_format>) or the generator
+// on loop 0, else a source per device of -d: "tcp://host[:port]" is an
+// rtl_tcp server, anything else a serial number for <open_device>. Counts
+// the inputs of each loop in <loop_inputs>, for init_commons().
+std::vector<LoopSource> create_sources(const SourceOptions& options,
+                                       SampleFormat capture_format,
+                                       const RtlSettings& rtl_tcp_settings,
+                                       const std::function<std::unique_ptr<SampleSource>(const std::string& serial)>& open_device,
+                                       std::vector<size_t>* loop_inputs);
+
+// Streams every source into its loop and reports every 100 ms, until
+// <do_exit>, the end of the captures, or a radio is lost (stopped, or no
+// samples for 2 s). False if a radio failed.
+bool stream_sources(std::vector<LoopSource>& sources, const std::atomic<bool>& do_exit);
+
+// Offline (-x): pulls <source> (sampled at <sample_rate>) into loop 0 as fast
+// as the CPU allows. report_detections() is called after every tenth of a
+// second of samples (virtual time), and once the passings in progress timed
+// out at the end.
+void stream_source_offline(SampleSource& source, uint32_t sample_rate, const std::atomic<bool>& do_exit);
@@ -0,0 +1,275 @@
+#include "shm_ring.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory ring needs lock-free 64 bit atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared memory ring needs lock-free 32 bit atomics");
+static_assert((SHM_RING_SLOTS & (SHM_RING_SLOTS - 1)) == 0, "SHM_RING_SLOTS must be a power of 2");
+
+static constexpr uint64_t slot_mask = SHM_RING_SLOTS - 1;
+
+#ifdef __linux__
+
+static std::string shm_path(const std::string& name) {
+    return name.front() == '/' ? name : "/" + name;
+}
+
+ShmRingWriter::~ShmRingWriter() {
+    close();
+}
+
+bool ShmRingWriter::open(const std::string& _name) {
+    close();
+    name = shm_path(_name);
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "shm_open(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, sizeof(ShmRing)) != 0) {
+        std::cerr << "ftruncate(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, sizeof(ShmRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        std::cerr << "mmap(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    ring = static_cast<ShmRing*>(p);
+
+    // a ring left behind by a previous run is continued, so sequence numbers
+    // never go backwards for readers which stayed attached
+    ShmRingHeader& header = ring->header;
+    if (header.magic != SHM_RING_MAGIC || header.version != SHM_RING_VERSION ||
+        header.slot_count != SHM_RING_SLOTS || header.record_size != sizeof(ShmRecord)) {
+        header.write_seq.store(0, std::memory_order_relaxed);
+        header.futex.store(0, std::memory_order_relaxed);
+        header.waiters.store(0, std::memory_order_relaxed);
+        for (auto& slot : ring->slots) {
+            slot.version.store(0, std::memory_order_relaxed);
+        }
+        header.slot_count = SHM_RING_SLOTS;
+        header.record_size = sizeof(ShmRecord);
+        header.version = SHM_RING_VERSION;
+        std::atomic_thread_fence(std::memory_order_release);
+        header.magic = SHM_RING_MAGIC;
+    }
+    return true;
+}
+
+void ShmRingWriter::close() {
+    if (ring != nullptr) {
+        munmap(ring, sizeof(ShmRing));
+        ring = nullptr;
+    }
+}
+
+ShmRecord& ShmRingWriter::begin_record(ShmRecordType type, uint32_t loop, uint64_t* seq) {
+    *seq = ring->header.write_seq.load(std::memory_order_relaxed) + 1;
+    ShmSlot& slot = ring->slots[*seq & slot_mask];
+    slot.version.store(2 * (*seq) - 1, std::memory_order_relaxed); // odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.record.seq = *seq;
+    slot.record.type = type;
+    slot.record.loop = loop;
+    return slot.record;
+}
+
+void ShmRingWriter::commit_record(uint64_t seq) {
+    ring->slots[seq & slot_mask].version.store(2 * seq, std::memory_order_release);
+    ring->header.write_seq.store(seq, std::memory_order_release);
+
+    // wake up sleeping readers, if there are any. Both sides bump their own
+    // counter before checking the other's (seq_cst): either the writer sees the
+    // waiter, or the waiter sees the new futex value and does not sleep.
+    ring->header.futex.fetch_add(1, std::memory_order_seq_cst);
+    if (ring->header.waiters.load(std::memory_order_seq_cst) != 0) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&ring->header.futex), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+}
+
+void ShmRingWriter::write_passing(uint32_t loop, const ShmPassing& passing) {
+    if (!ring) { return; }
+    uint64_t seq;
+    begin_record(ShmRecordType::PASSING, loop, &seq).passing = passing;
+    commit_record(seq);
+}
+
+void ShmRingWriter::write_timesync(uint32_t loop, const ShmTimeSync& timesync) {
+    if (!ring) { return; }
+    uint64_t seq;
+    begin_record(ShmRecordType::TIMESYNC, loop, &seq).timesync = timesync;
+    commit_record(seq);
+}
+
+void ShmRingWriter::write_status(uint32_t loop, const ShmStatus& status) {
+    if (!ring) { return; }
+    uint64_t seq;
+    begin_record(ShmRecordType::STATUS, loop, &seq).status = status;
+    commit_record(seq);
+}
+
+ShmRingReader::~ShmRingReader() {
+    close();
+}
+
+bool ShmRingReader::open(const std::string& name, bool from_oldest) {
+    close();
+
+    // sleeping on the futex takes registering in the header; without write
+    // access to the ring, wait() falls back to polling
+    writable = true;
+    int fd = shm_open(shm_path(name).c_str(), O_RDWR, 0);
+    if (fd < 0 && errno == EACCES) {
+        writable = false;
+        fd = shm_open(shm_path(name).c_str(), O_RDONLY, 0);
+    }
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ShmRing)) {
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, sizeof(ShmRing), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    ring = static_cast<ShmRing*>(p);
+
+    const ShmRingHeader& header = ring->header;
+    if (header.magic != SHM_RING_MAGIC || header.version != SHM_RING_VERSION ||
+        header.slot_count != SHM_RING_SLOTS || header.record_size != sizeof(ShmRecord)) {
+        close();
+        return false;
+    }
+
+    const uint64_t head = header.write_seq.load(std::memory_order_acquire);
+    read_seq = head;
+    if (from_oldest) {
+        read_seq = head > SHM_RING_SLOTS ? head - SHM_RING_SLOTS : 0;
+    }
+    lost_records = 0;
+    return true;
+}
+
+void ShmRingReader::close() {
+    if (ring != nullptr) {
+        munmap(ring, sizeof(ShmRing));
+        ring = nullptr;
+    }
+}
+
+bool ShmRingReader::next(ShmRecord* record) {
+    if (!ring) { return false; }
+
+    while (true) {
+        const uint64_t head = ring->header.write_seq.load(std::memory_order_acquire);
+        if (read_seq >= head) {
+            return false;
+        }
+
+        uint64_t seq = read_seq + 1;
+        if (head - seq >= SHM_RING_SLOTS) {
+            // lapped by the writer: skip to the oldest record still in the ring
+            const uint64_t oldest = head - SHM_RING_SLOTS + 1;
+            lost_records += oldest - seq;
+            seq = oldest;
+        }
+
+        const ShmSlot& slot = ring->slots[seq & slot_mask];
+        const uint64_t v1 = slot.version.load(std::memory_order_acquire);
+        std::memcpy(static_cast<void*>(record), &slot.record, sizeof(ShmRecord));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t v2 = slot.version.load(std::memory_order_relaxed);
+
+        read_seq = seq;
+        if (v1 == 2 * seq && v2 == v1) {
+            return true;
+        }
+        // overwritten while copying
+        lost_records++;
+    }
+}
+
+bool ShmRingReader::wait(std::chrono::milliseconds timeout) {
+    if (!ring) { return false; }
+
+    if (!writable) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (read_seq >= ring->header.write_seq.load(std::memory_order_acquire)) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(SHM_RING_POLL_MS));
+        }
+        return true;
+    }
+
+    // register before reading the futex value (see commit_record())
+    ring->header.waiters.fetch_add(1, std::memory_order_seq_cst);
+    const uint32_t futex = ring->header.futex.load(std::memory_order_seq_cst);
+    if (read_seq >= ring->header.write_seq.load(std::memory_order_acquire)) {
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+        ts.tv_nsec = static_cast<long>((timeout.count() % 1000) * 1000000);
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&ring->header.futex), FUTEX_WAIT, futex, &ts, nullptr, 0);
+    }
+    ring->header.waiters.fetch_sub(1, std::memory_order_relaxed);
+
+    return read_seq < ring->header.write_seq.load(std::memory_order_acquire);
+}
+
+#else
+
+// POSIX shared memory with futex wake-ups is Linux-only; elsewhere the ring
+// can not be opened, and every operation is a no-op.
+
+ShmRingWriter::~ShmRingWriter() {}
+
+bool ShmRingWriter::open(const std::string&) {
+    std::cerr << "Shared memory output is not supported on this platform" << std::endl;
+    return false;
+}
+
+void ShmRingWriter::close() {}
+void ShmRingWriter::write_passing(uint32_t, const ShmPassing&) {}
+void ShmRingWriter::write_timesync(uint32_t, const ShmTimeSync&) {}
+void ShmRingWriter::write_status(uint32_t, const ShmStatus&) {}
+
+ShmRingReader::~ShmRingReader() {}
+
+bool ShmRingReader::open(const std::string&, bool) {
+    return false;
+}
+
+void ShmRingReader::close() {}
+
+bool ShmRingReader::next(ShmRecord*) {
+    return false;
+}
+
+bool ShmRingReader::wait(std::chrono::milliseconds timeout) {
+    std::this_thread::sleep_for(timeout);
+    return false;
+}
+
+#endif
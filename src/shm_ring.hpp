@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Single-writer, multi-reader ring of fixed-size records in POSIX shared
+// memory (/dev/shm/<name>), for consumers running on the same host as the
+// decoder. Readers poll the ring without syscalls; when caught up, they can
+// sleep on a futex. Sleeping readers register in the header, and the writer
+// only makes the wake-up syscall while there are any. Linux only.
+//
+// Every slot is guarded by a seqlock-like version: it is odd while the record
+// is being written, and 2*seq once record #seq is complete. A reader that falls
+// behind more than SHM_RING_SLOTS records skips ahead and counts the loss.
+
+#define SHM_RING_MAGIC 0x4f53524eu // "OSRN"
+#define SHM_RING_VERSION 3u
+#define SHM_RING_SLOTS 4096u       // power of 2
+#define SHM_RING_DEFAULT_NAME "openstint"
+#define SHM_RING_POLL_MS 1         // wait() of read-only readers
+
+enum class ShmRecordType : uint32_t {
+    PASSING = 1,
+    TIMESYNC = 2,
+    STATUS = 3,
+};
+
+// same fields as the text protocol's P message
+struct ShmPassing {
+    uint64_t timestamp;          // ms, same timebase as the published messages
+    uint64_t duration;           // us
+    uint32_t transponder_system; // 0: OpenStint, 1: AMB
+    uint32_t transponder_id;
+    float rssi;
+    uint32_t hits;
+    uint32_t gap;                // 1: samples were lost during the passing
+};
+
+// same fields as the text protocol's T message
+struct ShmTimeSync {
+    uint64_t timestamp;
+    uint32_t transponder_system;
+    uint32_t transponder_id;
+    uint32_t transponder_timestamp;
+};
+
+// same fields as the text protocol's S message
+struct ShmStatus {
+    uint64_t timestamp;
+    float noise_power;
+    float dc_offset;
+    uint32_t frames_received;
+    uint32_t frames_processed;
+};
+
+struct ShmRecord {
+    uint64_t seq; // 1, 2, 3, ...
+    ShmRecordType type;
+    uint32_t loop; // the radio (loop) the record comes from, as in the text protocol
+    union {
+        ShmPassing passing;
+        ShmTimeSync timesync;
+        ShmStatus status;
+    };
+};
+
+struct ShmSlot {
+    std::atomic<uint64_t> version;
+    ShmRecord record;
+};
+
+struct ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t record_size;
+    std::atomic<uint64_t> write_seq; // last completed record
+    std::atomic<uint32_t> futex;     // bumped on every record
+    std::atomic<uint32_t> waiters;   // readers sleeping on the futex
+};
+
+struct ShmRing {
+    ShmRingHeader header;
+    ShmSlot slots[SHM_RING_SLOTS];
+};
+
+class ShmRingWriter {
+    ShmRing* ring = nullptr;
+    std::string name;
+
+public:
+    ShmRingWriter() = default;
+    ~ShmRingWriter();
+    ShmRingWriter(const ShmRingWriter&) = delete;
+    ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+    // create (or take over) /dev/shm/<name>
+    bool open(const std::string& name);
+    void close();
+    bool is_open() const { return ring != nullptr; }
+
+    void write_passing(uint32_t loop, const ShmPassing& passing);
+    void write_timesync(uint32_t loop, const ShmTimeSync& timesync);
+    void write_status(uint32_t loop, const ShmStatus& status);
+
+private:
+    ShmRecord& begin_record(ShmRecordType type, uint32_t loop, uint64_t* seq);
+    void commit_record(uint64_t seq);
+};
+
+class ShmRingReader {
+    ShmRing* ring = nullptr;
+    bool writable = false; // may register as a waiter (write access to the ring)
+    uint64_t read_seq = 0; // last consumed record
+    uint64_t lost_records = 0;
+
+public:
+    ShmRingReader() = default;
+    ~ShmRingReader();
+    ShmRingReader(const ShmRingReader&) = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+    // attach to a running decoder's ring; by default, only new records are read
+    bool open(const std::string& name, bool from_oldest = false);
+    void close();
+
+    // copy the next record, if there is one; never blocks
+    bool next(ShmRecord* record);
+    // sleep until the writer publishes something new (or the timeout expires);
+    // readers without write access to the ring poll every SHM_RING_POLL_MS instead
+    bool wait(std::chrono::milliseconds timeout);
+    // records overwritten before this reader could consume them
+    uint64_t lost() const { return lost_records; }
+};
@@ -0,0 +1,89 @@
+#include <csignal>
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "shm_ring.hpp"
+
+// Example consumer of the decoder's shared-memory output (-S flag). Prints the
+// records in the same format as the published text messages.
+
+static volatile std::sig_atomic_t do_exit = 0;
+
+void signal_handler(int) {
+    do_exit = 1;
+}
+
+static const char* system_name(uint32_t transponder_system) {
+    return transponder_system == 0 ? "OPN" : "AMB";
+}
+
+int main(int argc, char** argv) {
+    std::string name = SHM_RING_DEFAULT_NAME;
+    bool from_oldest = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-a") {
+            from_oldest = true;
+        } else if (arg[0] != '-') {
+            name = arg;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [-a] [name]\n";
+            std::cerr << "\t-a          default:off \tStart with the oldest record still in the ring\n";
+            std::cerr << "\tname        default:" << SHM_RING_DEFAULT_NAME << "\tShared memory ring name (/dev/shm/<name>)\n";
+            return 1;
+        }
+    }
+
+    ShmRingReader reader;
+    if (!reader.open(name, from_oldest)) {
+        std::cerr << "Failed to attach to shared memory ring '" << name << "'\n";
+        return EXIT_FAILURE;
+    }
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    ShmRecord record;
+    while (!do_exit) {
+        if (!reader.next(&record)) {
+            reader.wait(std::chrono::milliseconds(500));
+            continue;
+        }
+        switch (record.type) {
+            case ShmRecordType::PASSING:
+            std::cout << "P " << record.passing.timestamp
+                      << " " << system_name(record.passing.transponder_system)
+                      << " " << record.passing.transponder_id
+                      << " " << record.passing.rssi
+                      << " " << record.passing.hits
+                      << " " << record.passing.duration
+                      << " " << record.loop
+                      << " " << record.passing.gap << "\n";
+            break;
+            case ShmRecordType::TIMESYNC:
+            std::cout << "T " << record.timesync.timestamp
+                      << " " << system_name(record.timesync.transponder_system)
+                      << " " << record.timesync.transponder_id
+                      << " " << record.timesync.transponder_timestamp
+                      << " " << record.loop << "\n";
+            break;
+            case ShmRecordType::STATUS:
+            std::cout << "S " << record.status.timestamp
+                      << " " << record.status.noise_power
+                      << " " << record.status.dc_offset
+                      << " " << record.status.frames_received
+                      << " " << record.status.frames_processed
+                      << " " << record.loop << "\n";
+            break;
+        }
+        std::cout.flush();
+    }
+
+    if (reader.lost() > 0) {
+        std::cerr << "Lost " << reader.lost() << " records\n";
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Minimum (std::less) or maximum (std::greater) of a sliding window over a
+// stream of values: a monotonic queue, O(1) amortized per value. Values are
+// pushed with increasing positions and expire by position; at most <capacity>
+// of them may be in the window.
+template<typename T, typename Compare>
+class SlidingExtreme {
+    struct Item {
+        uint64_t position;
+        T value;
+    };
+    std::vector<Item> items; // ring
+    uint64_t front = 0;
+    uint64_t back = 0;
+    Compare compare;
+
+public:
+    explicit SlidingExtreme(size_t capacity) : items(capacity) {}
+
+    void push(uint64_t position, T value) {
+        // values which can not be the extreme of any window with this one in it
+        while (back > front && !compare(items[(back - 1) % items.size()].value, value)) {
+            back--;
+        }
+        items[back++ % items.size()] = { position, value };
+    }
+
+    // forget the values before <position>
+    void expire(uint64_t position) {
+        while (back > front && items[front % items.size()].position < position) {
+            front++;
+        }
+    }
+
+    // forget all values, keeping the storage
+    void clear() { front = back = 0; }
+
+    bool empty() const { return back == front; }
+    T value() const { return items[front % items.size()].value; }
+};
@@ -0,0 +1,172 @@
+#include "tcp_socket.hpp"
+
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#define INVALID_HANDLE (~static_cast<uintptr_t>(0))
+#define SHUTDOWN_BOTH SD_BOTH
+#define close_handle(h) closesocket(static_cast<SOCKET>(h))
+#define to_socket(h) static_cast<SOCKET>(h)
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define INVALID_HANDLE (-1)
+#define SHUTDOWN_BOTH SHUT_RDWR
+#define close_handle(h) ::close(h)
+#define to_socket(h) (h)
+#endif
+
+
+#ifdef _WIN32
+// winsock is initialized once, for the lifetime of the process
+static bool startup() {
+    static const bool started = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return started;
+}
+#else
+static bool startup() {
+    return true;
+}
+#endif
+
+TcpSocket::~TcpSocket() {
+    close();
+}
+
+TcpSocket::TcpSocket(TcpSocket&& other) noexcept : handle(std::exchange(other.handle, INVALID_HANDLE)) {}
+
+TcpSocket& TcpSocket::operator=(TcpSocket&& other) noexcept {
+    if (this != &other) {
+        close();
+        handle = std::exchange(other.handle, INVALID_HANDLE);
+    }
+    return *this;
+}
+
+bool TcpSocket::connect(const std::string& host, uint16_t port) {
+    close();
+    if (!startup()) {
+        return false;
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+        return false;
+    }
+    for (addrinfo* a = addresses; a != nullptr; a = a->ai_next) {
+        auto s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (s == to_socket(INVALID_HANDLE)) {
+            continue;
+        }
+        if (::connect(s, a->ai_addr, static_cast<socklen_t>(a->ai_addrlen)) == 0) {
+            handle = s;
+            break;
+        }
+        close_handle(s);
+    }
+    freeaddrinfo(addresses);
+    if (!is_open()) {
+        return false;
+    }
+
+    // samples flow one way, commands are tiny: send them right away
+    int one = 1;
+    setsockopt(to_socket(handle), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+    return true;
+}
+
+bool TcpSocket::listen(uint16_t port) {
+    close();
+    if (!startup()) {
+        return false;
+    }
+
+    auto s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == to_socket(INVALID_HANDLE)) {
+        return false;
+    }
+    handle = s;
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&one), sizeof(one));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(s, 1) != 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+TcpSocket TcpSocket::accept() {
+    TcpSocket client;
+    auto s = ::accept(to_socket(handle), nullptr, nullptr);
+    if (s != to_socket(INVALID_HANDLE)) {
+        client.handle = s;
+    }
+    return client;
+}
+
+bool TcpSocket::send_all(const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        const auto n = ::send(to_socket(handle), p, static_cast<int>(size), 0);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool TcpSocket::recv_all(void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        const auto n = ::recv(to_socket(handle), p, static_cast<int>(size), 0);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void TcpSocket::shutdown() {
+    if (is_open()) {
+        ::shutdown(to_socket(handle), SHUTDOWN_BOTH);
+    }
+}
+
+void TcpSocket::close() {
+    if (is_open()) {
+        close_handle(handle);
+        handle = INVALID_HANDLE;
+    }
+}
+
+bool TcpSocket::is_open() const {
+    return handle != INVALID_HANDLE;
+}
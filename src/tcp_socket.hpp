@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Blocking TCP stream socket: just enough for rtl_tcp, client and server side.
+class TcpSocket {
+#ifdef _WIN32
+    uintptr_t handle = ~static_cast<uintptr_t>(0);
+#else
+    int handle = -1;
+#endif
+
+public:
+    TcpSocket() = default;
+    ~TcpSocket();
+    TcpSocket(TcpSocket&& other) noexcept;
+    TcpSocket& operator=(TcpSocket&& other) noexcept;
+    TcpSocket(const TcpSocket&) = delete;
+    TcpSocket& operator=(const TcpSocket&) = delete;
+
+    bool connect(const std::string& host, uint16_t port);
+    // listen on every interface; accept() then waits for a client
+    bool listen(uint16_t port);
+    TcpSocket accept();
+
+    // false if the connection was closed (or failed) before all of it was transferred
+    bool send_all(const void* data, size_t size);
+    bool recv_all(void* data, size_t size);
+    // wakes up a thread blocked in send/recv; the socket stays open
+    void shutdown();
+    void close();
+    bool is_open() const;
+};
@@ -0,0 +1,94 @@
+// Early abort of hopeless frames (SymbolReader::is_frame_viable()) and what
+// the aborts amount to for the adaptive preamble thresholds. The noise gate
+// applies from 24 symbols on, the preamble is checked at 32: frames given up
+// before the preamble was confirmed (noise, mostly) are false triggers, frames
+// given up after it (a transponder gone mid-frame) are not.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "frame.hpp"
+#include "threshold_control.hpp"
+#include "transponder.hpp"
+
+#define TEST_SPS 2
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+// Feeds soft bits to is_frame_viable() the way the receiver reads them, one
+// symbol at a time; returns the number of symbols read when the frame was
+// given up (0: never), and what the abort amounts to. The first <clean>
+// symbols are of a strong frame, the rest have the given EVM and confidence.
+static size_t read_frame(SymbolReader<TEST_SPS>& reader, bool with_preamble, size_t clean, float evm, uint8_t confidence, FrameOutcome* outcome) {
+    Frame frame(TransponderProtocol::RC3, 0.9f, 0, 0);
+    const uint16_t preamble = transponder_props(TransponderProtocol::RC3).preamble;
+    for (size_t i = 0; i < 200; i++) {
+        const float symbol_evm = (i < clean) ? 0.2f : evm;
+        const uint8_t symbol_confidence = (i < clean) ? 240 : confidence;
+        // a bit pattern which does not hold the preamble anywhere, or the preamble at bit 2
+        bool bit = (i % 3 == 0);
+        if (with_preamble && i >= 2 && i < 18) {
+            bit = (preamble >> (15 - (i - 2))) & 1;
+        }
+        frame.softbits.push_back(bit ? 127 + symbol_confidence / 2 : 128 - symbol_confidence / 2);
+        frame.evm_sum += symbol_evm;
+        frame.confidence_sum += std::abs(2 * static_cast<int>(frame.softbits.back()) - 255);
+        if (!reader.is_frame_viable(&frame, outcome)) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+int main() {
+    SymbolReader<TEST_SPS> reader;
+    FrameOutcome outcome;
+
+    check(read_frame(reader, true, 0, 0.2f, 240, &outcome) == 0, "a clean frame is read to the end");
+    check(read_frame(reader, true, 0, 0.6f, 160, &outcome) == 0, "a weak frame (3 dB) is read to the end");
+
+    // the noise gate, from 24 symbols: before the preamble is checked, a false trigger
+    const size_t noise_abort = read_frame(reader, false, 0, 0.95f, 130, &outcome);
+    check(noise_abort >= 24 && noise_abort < 32, "noise is given up between 24 and 31 symbols");
+    check(outcome == FrameOutcome::NO_SYNC, "noise given up before 32 symbols is a false trigger");
+    const size_t faint_abort = read_frame(reader, false, 0, 0.5f, 20, &outcome);
+    check(faint_abort >= 24 && faint_abort < 32, "faint noise is given up between 24 and 31 symbols");
+    check(outcome == FrameOutcome::NO_SYNC, "faint noise given up before 32 symbols is a false trigger");
+
+    // the preamble check, at 32 symbols
+    check(read_frame(reader, false, 0, 0.3f, 200, &outcome) == 32, "a frame without preamble is given up at 32 symbols");
+    check(outcome == FrameOutcome::NO_SYNC, "a frame without preamble is a false trigger");
+
+    // the noise gate after the preamble: a real frame, lost mid-way
+    const size_t lost_abort = read_frame(reader, true, 40, 1.0f, 0, &outcome);
+    check(lost_abort > 32, "a frame lost mid-way is given up after its preamble");
+    check(outcome == FrameOutcome::REJECTED, "a frame lost mid-way is not a false trigger");
+
+    // noise triggers raise the threshold, frames lost mid-way do not
+    ThresholdController controller;
+    const float threshold = controller.threshold(TransponderProtocol::RC3);
+    for (uint64_t timestamp = 0; timestamp <= 2 * THRESHOLD_CONTROL_PERIOD_US; timestamp += 1000) {
+        read_frame(reader, true, 40, 1.0f, 0, &outcome);
+        controller.feedback(TransponderProtocol::RC3, outcome, timestamp);
+    }
+    check(controller.threshold(TransponderProtocol::RC3) == threshold, "frames lost mid-way do not raise the threshold");
+    for (uint64_t timestamp = 2 * THRESHOLD_CONTROL_PERIOD_US; timestamp <= 4 * THRESHOLD_CONTROL_PERIOD_US; timestamp += 1000) {
+        read_frame(reader, false, 0, 0.95f, 130, &outcome);
+        controller.feedback(TransponderProtocol::RC3, outcome, timestamp);
+    }
+    check(controller.threshold(TransponderProtocol::RC3) > threshold, "noise aborted at 24-31 symbols raises the threshold");
+
+    if (failures > 0) {
+        return EXIT_FAILURE;
+    }
+    std::cout << "frame abort: OK" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+// Sample loss detection of SampleClock: a host delay must not pass for lost
+// samples, a lost transfer must be counted once, and whole.
+//
+// Buffers are fed the way DecoderPipeline::process() does: missing_samples(),
+// then (with the counter advanced by the confirmed loss) update().
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "sample_clock.hpp"
+
+#define TEST_SAMPLE_RATE 10000000u
+#define TEST_BUFFER 131072u       // hackrf transfer: 13.1 ms
+#define TEST_JITTER_US 200        // peak host jitter
+#define TEST_WARMUP 256           // buffers before the event
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+// Runs <buffers> buffers through a clock. Buffer #lost_at and the ones after
+// it lose <lost_buffers> transfers' worth of counter (the radio dropped them);
+// buffer #delayed_at alone is processed <delay_us> late. Returns the samples
+// the clock reported lost; *reported_at is the buffer it was reported at.
+static uint64_t run(uint32_t buffers, uint32_t lost_at, uint64_t lost_buffers, uint32_t delayed_at, uint64_t delay_us, uint32_t* reported_at) {
+    SampleClock clock(TEST_SAMPLE_RATE);
+    uint64_t timecode = 0;  // the decoder's counter
+    uint64_t radio = 0;     // samples the radio produced
+    uint64_t lost_total = 0;
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < buffers; i++) {
+        if (i == lost_at) {
+            radio += lost_buffers * TEST_BUFFER;
+        }
+        radio += TEST_BUFFER;
+
+        seed = seed * 1103515245u + 12345u;
+        const uint64_t jitter = (seed >> 16) % TEST_JITTER_US;
+        uint64_t host_time = 1000000 + radio * 1000000 / TEST_SAMPLE_RATE + jitter;
+        if (i == delayed_at) {
+            host_time += delay_us;
+        }
+
+        const uint64_t lost = clock.missing_samples(timecode + TEST_BUFFER, host_time, TEST_BUFFER);
+        if (lost > 0) {
+            lost_total += lost;
+            *reported_at = i;
+            timecode += lost;
+        }
+        clock.update(timecode + TEST_BUFFER, host_time);
+        timecode += TEST_BUFFER;
+    }
+    return lost_total;
+}
+
+int main() {
+    const uint64_t buffer_us = static_cast<uint64_t>(TEST_BUFFER) * 1000000 / TEST_SAMPLE_RATE;
+    uint32_t reported_at = 0;
+
+    // one late buffer, on-time buffers after it: no drop
+    check(run(TEST_WARMUP + 16, UINT32_MAX, 0, TEST_WARMUP, buffer_us / 2, &reported_at) == 0,
+        "a buffer half a transfer late is a delay");
+    check(run(TEST_WARMUP + 16, UINT32_MAX, 0, TEST_WARMUP, buffer_us * 3 / 2, &reported_at) == 0,
+        "a buffer 1.5 transfers late, followed by on-time ones, is a delay");
+    check(run(TEST_WARMUP + 16, UINT32_MAX, 0, TEST_WARMUP, buffer_us * 3, &reported_at) == 0,
+        "a buffer 3 transfers late, followed by on-time ones, is a delay");
+
+    // lost transfers: counted once, whole, after the confirmation
+    reported_at = 0;
+    check(run(TEST_WARMUP + 16, TEST_WARMUP, 1, UINT32_MAX, 0, &reported_at) == TEST_BUFFER,
+        "a lost transfer is counted");
+    check(reported_at == TEST_WARMUP + SAMPLE_CLOCK_GAP_CONFIRM,
+        "a lost transfer is reported once confirmed");
+    check(run(TEST_WARMUP + 16, TEST_WARMUP, 3, UINT32_MAX, 0, &reported_at) == 3 * TEST_BUFFER,
+        "3 lost transfers are counted");
+
+    if (failures > 0) {
+        return EXIT_FAILURE;
+    }
+    std::cout << "sample clock: OK" << std::endl;
+    return EXIT_SUCCESS;
+}
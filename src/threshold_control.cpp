@@ -0,0 +1,50 @@
+#include "threshold_control.hpp"
+
+#include <algorithm>
+
+ThresholdController::ThresholdController() {
+    for (int i=0; i<3; i++) {
+        Loop& loop = loops[i];
+        loop.floor = default_preamble_threshold(static_cast<TransponderProtocol>(i));
+        loop.ceiling = loop.floor * THRESHOLD_MAX / default_preamble_threshold(TransponderProtocol::RC4);
+        loop.threshold = loop.floor;
+        published[i] = loop.threshold;
+    }
+}
+
+bool ThresholdController::feedback(TransponderProtocol protocol, FrameOutcome outcome, uint64_t timestamp) {
+    if (!started) {
+        period_start = timestamp;
+        started = true;
+    }
+    if (outcome == FrameOutcome::NO_SYNC) {
+        loops[static_cast<int>(protocol)].false_triggers++;
+    }
+
+    const uint64_t elapsed = (timestamp > period_start) ? (timestamp - period_start) : 0;
+    if (elapsed < THRESHOLD_CONTROL_PERIOD_US) {
+        return false;
+    }
+
+    // a quiet spell (no triggers at all) is made up for by easing back
+    // as many steps as periods passed
+    const float periods = static_cast<float>(elapsed) / THRESHOLD_CONTROL_PERIOD_US;
+    for (int i=0; i<3; i++) {
+        Loop& loop = loops[i];
+        const float rate = loop.false_triggers * 1e6f / static_cast<float>(elapsed);
+        if (rate > THRESHOLD_FALSE_TRIGGER_RATE) {
+            const float steps = std::min(rate / THRESHOLD_FALSE_TRIGGER_RATE, THRESHOLD_MAX_STEPS);
+            loop.threshold = std::min(loop.threshold + steps * THRESHOLD_STEP, loop.ceiling);
+        } else if (rate < THRESHOLD_FALSE_TRIGGER_RATE / 2.0f) {
+            loop.threshold = std::max(loop.threshold - periods * THRESHOLD_STEP, loop.floor);
+        }
+        loop.false_triggers = 0;
+        published[i].store(loop.threshold, std::memory_order_relaxed);
+    }
+    period_start = timestamp;
+    return true;
+}
+
+float ThresholdController::threshold(TransponderProtocol protocol) const {
+    return published[static_cast<int>(protocol)].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "frame.hpp"
+#include "transponder.hpp"
+
+#define THRESHOLD_FALSE_TRIGGER_RATE 20.0f   // target, false triggers per second and protocol
+#define THRESHOLD_CONTROL_PERIOD_US 1000000  // false triggers are counted over this long
+#define THRESHOLD_STEP 0.01f                 // per control period, at most THRESHOLD_MAX_STEPS of it
+#define THRESHOLD_MAX_STEPS 4.0f
+#define THRESHOLD_MAX 0.95f                  // highest 16-bit match threshold; 15-bit matches scaled alike
+
+// Match thresholds of the preamble search, adapted to the noise of the track.
+//
+// Every preamble match costs a full training and reading of the frame, and
+// the search is blind meanwhile. A match whose demodulated bits do not hold
+// the preamble, or which was given up as noise before the preamble could be
+// checked (FrameOutcome::NO_SYNC), is a false trigger. Per protocol, the
+// false triggers are counted over THRESHOLD_CONTROL_PERIOD_US: above
+// THRESHOLD_FALSE_TRIGGER_RATE the threshold is raised, in proportion to the
+// excess; below half of it, it eases back towards the default
+// (PREAMBLE_THRESHOLD), which is also its lower bound. Frames failing their
+// CRC do not count: on a busy track these are collisions and weak frames,
+// not noise.
+//
+// feedback() is called from the thread of the receiver, threshold() may be
+// called from any thread.
+class ThresholdController {
+    struct Loop {
+        float floor = 0.0f;   // default threshold
+        float ceiling = 0.0f;
+        float threshold = 0.0f;
+        uint32_t false_triggers = 0; // in the current period
+    };
+
+    Loop loops[3]; // by TransponderProtocol
+    std::atomic<float> published[3];
+    uint64_t period_start = 0;
+    bool started = false;
+
+public:
+    ThresholdController();
+
+    // outcome of a frame the preamble search triggered on, at <timestamp> (us);
+    // true if the thresholds were re-evaluated (apply them to the receiver)
+    bool feedback(TransponderProtocol protocol, FrameOutcome outcome, uint64_t timestamp);
+
+    float threshold(TransponderProtocol protocol) const;
+};
@@ -0,0 +1,161 @@
+#include "timebase.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <vector>
+
+static const double adev_taus[] = { 1.0, 10.0, 100.0 };
+
+bool DriftEstimator::Reference::established() const {
+    return fit.count > 2 && (last_timestamp - first_timestamp) >= DRIFT_MIN_SPAN_US;
+}
+
+// phase (us) at transponder time <t> (s), interpolated between time-syncs at most 2 s apart
+static bool phase_at(const std::deque<std::pair<double, double>>& phase, double t, double* x) {
+    auto it = std::lower_bound(phase.begin(), phase.end(), t, [](const std::pair<double, double>& p, double value) {
+        return p.first < value;
+    });
+    if (it == phase.end() || it == phase.begin()) {
+        return false;
+    }
+    const auto& [t1, x1] = *it;
+    const auto& [t0, x0] = *std::prev(it);
+    if (t1 - t0 > 2.0) {
+        return false; // the reference was away
+    }
+    *x = x0 + (x1 - x0) * (t - t0) / (t1 - t0);
+    return true;
+}
+
+// overlapping Allan deviation of an irregularly sampled phase record
+static float allan_deviation(const std::deque<std::pair<double, double>>& phase, double tau) {
+    if (phase.empty() || phase.back().first - phase.front().first < 2.0 * tau) {
+        return 0.0f;
+    }
+    double sum = 0.0;
+    size_t count = 0;
+    for (const auto& [t, x0] : phase) {
+        double x1, x2;
+        if (t + 2.0 * tau > phase.back().first) {
+            break;
+        }
+        if (phase_at(phase, t + tau, &x1) && phase_at(phase, t + 2.0 * tau, &x2)) {
+            const double d = (x2 - 2.0 * x1 + x0) * 1e-6; // s
+            sum += d * d;
+            count++;
+        }
+    }
+    if (count == 0) {
+        return 0.0f;
+    }
+    return static_cast<float>(std::sqrt(0.5 * sum / static_cast<double>(count)) / tau);
+}
+
+double DriftEstimator::corrected(double timestamp) const {
+    return anchor_corrected + (timestamp - anchor_timestamp) / (1.0 + rate);
+}
+
+void DriftEstimator::restart(Reference& reference, const TimeSync& time_sync) {
+    reference = Reference();
+    reference.first_timestamp = time_sync.timestamp;
+    reference.last_timestamp = time_sync.timestamp;
+    reference.last_timecode = time_sync.transponder_timestamp;
+    reference.fit.add(0.0, 0.0, DRIFT_WINDOW);
+    reference.phase.push_back({ 0.0, 0.0 });
+}
+
+void DriftEstimator::add(const TimeSync& time_sync) {
+    if (time_sync.transponder_type != TransponderSystem::OpenStint) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto [it, inserted] = references.try_emplace(time_sync.transponder_id);
+    Reference& reference = it->second;
+    if (inserted) {
+        restart(reference, time_sync);
+        return;
+    }
+    if (time_sync.transponder_timestamp == reference.last_timecode || time_sync.timestamp <= reference.last_timestamp) {
+        return; // the same frame on an other loop, or out of order
+    }
+
+    // unwrap: pick the rollover count closest to the time elapsed on the decoder
+    const double decoder_delta = static_cast<double>(time_sync.timestamp - reference.last_timestamp);
+    const int64_t raw_delta = (static_cast<int64_t>(time_sync.transponder_timestamp) - reference.last_timecode) & (TIMESYNC_WRAP - 1);
+    const double rollovers = std::round((decoder_delta / TIMESYNC_TICK_US - static_cast<double>(raw_delta)) / TIMESYNC_WRAP);
+    const int64_t delta = raw_delta + static_cast<int64_t>(rollovers) * TIMESYNC_WRAP;
+    if (delta <= 0) {
+        restart(reference, time_sync);
+        return;
+    }
+
+    const uint64_t transponder_time = reference.transponder_time + static_cast<uint64_t>(delta) * TIMESYNC_TICK_US;
+    const double x = static_cast<double>(transponder_time);
+    const double y = static_cast<double>(time_sync.timestamp - reference.first_timestamp) - x;
+    if (reference.fit.count > 2 && std::abs(y - reference.fit.predict(x)) > DRIFT_RESET_US) {
+        restart(reference, time_sync);
+        return;
+    }
+    reference.transponder_time = transponder_time;
+    reference.last_timestamp = time_sync.timestamp;
+    reference.last_timecode = time_sync.transponder_timestamp;
+    reference.fit.add(x, y, DRIFT_WINDOW);
+    reference.phase.push_back({ x * 1e-6, y });
+    while (reference.phase.back().first - reference.phase.front().first > DRIFT_HISTORY_US * 1e-6) {
+        reference.phase.pop_front();
+    }
+
+    // references gone for long (ie. the parked car left) no longer count
+    std::erase_if(references, [&time_sync](const auto& entry) {
+        return entry.second.last_timestamp + DRIFT_STALE_US < time_sync.timestamp;
+    });
+
+    double slope_sum = 0.0;
+    size_t slope_count = 0;
+    for (const auto& [transponder_id, r] : references) {
+        if (r.established()) {
+            slope_sum += r.fit.slope();
+            slope_count++;
+        }
+    }
+    if (slope_count > 0) {
+        // re-anchor, so the corrected clock does not jump with the new rate
+        const double timestamp = static_cast<double>(time_sync.timestamp);
+        anchor_corrected = corrected(timestamp);
+        anchor_timestamp = timestamp;
+        rate = slope_sum / static_cast<double>(slope_count);
+    }
+}
+
+uint64_t DriftEstimator::correct(uint64_t timestamp) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const double t = corrected(static_cast<double>(timestamp));
+    return t > 0.0 ? static_cast<uint64_t>(std::llround(t)) : 0;
+}
+
+bool DriftEstimator::status(DriftStatus* status) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // the Allan deviation of the reference with the longest record
+    const Reference* best = nullptr;
+    uint32_t established = 0;
+    for (const auto& [transponder_id, r] : references) {
+        if (r.established()) {
+            established++;
+            if (!best || r.phase.size() > best->phase.size()) {
+                best = &r;
+            }
+        }
+    }
+    if (!best) {
+        return false;
+    }
+    status->ppm = static_cast<float>(rate * 1e6);
+    for (size_t i = 0; i < std::size(adev_taus); i++) {
+        status->adev[i] = allan_deviation(best->phase, adev_taus[i]);
+    }
+    status->references = established;
+    return true;
+}
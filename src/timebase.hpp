@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "linear_fit.hpp"
+#include "passing.hpp"
+
+#define TIMESYNC_TICK_US 100              // transponder timecode resolution
+#define TIMESYNC_WRAP (1u << 20)          // 20-bit timecode: wraps every 104.8576 s
+#define DRIFT_WINDOW 600                  // time-syncs per reference (~10 minutes)
+#define DRIFT_MIN_SPAN_US 10000000ull     // a reference is used after 10 s
+#define DRIFT_RESET_US 50000              // a time-sync this far off restarts the reference (ie. transponder reset)
+#define DRIFT_HISTORY_US 300000000ull     // phase history for the Allan deviation (5 minutes)
+#define DRIFT_STALE_US 600000000ull       // a reference not heard of for 10 minutes is dropped
+
+struct DriftStatus {
+    float ppm;          // host clock against the references; positive: the host runs fast
+    float adev[3];      // Allan deviation at tau = 1, 10, 100 s (0: not enough data yet)
+    uint32_t references;
+};
+
+// Host clock drift, measured against the crystals of OpenStint transponders
+// sending time-sync frames (ie. a car parked on the loop).
+//
+// The 20-bit transponder timecodes are unwrapped with the decoder's clock, and
+// the decoder time is fitted against the transponder time per reference. The
+// rate of the references in use is averaged, and timestamps are corrected by
+// it: the corrected clock runs at the references' rate, continuously, even as
+// the estimate changes. Decoders measuring the same references agree on the
+// length of a second, whatever their host clocks (and NTP) do.
+class DriftEstimator {
+    struct Reference {
+        uint64_t first_timestamp = 0;  // decoder, us
+        uint64_t last_timestamp = 0;
+        uint32_t last_timecode = 0;    // raw, 20 bits
+        uint64_t transponder_time = 0; // unwrapped, us since the first time-sync
+        LinearFit fit;                 // x: transponder time, y: decoder time - transponder time (us)
+        std::deque<std::pair<double, double>> phase; // (transponder time s, decoder - transponder us)
+
+        bool established() const;
+    };
+
+    std::map<uint32_t, Reference> references;
+    double rate = 0.0;             // fractional; the average slope of the references
+    double anchor_timestamp = 0.0; // correction is continuous from here
+    double anchor_corrected = 0.0;
+    mutable std::mutex mutex;
+
+    double corrected(double timestamp) const;
+    void restart(Reference& reference, const TimeSync& time_sync);
+
+public:
+    // a time-sync of an OpenStint transponder (others are ignored)
+    void add(const TimeSync& time_sync);
+    // decoder timestamp (us) -> on the references' rate (us)
+    uint64_t correct(uint64_t timestamp) const;
+    // false until a reference is in use
+    bool status(DriftStatus* status) const;
+};
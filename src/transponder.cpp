@@ -8,15 +8,22 @@ extern "C" {
 }
 #include <liquid/liquid.h>
 
-static void *viterbi_decoder;
 static crc_scheme crc8_scheme = LIQUID_CRC_8;
 
+// the trellis is decoder state: one per thread, so receivers can decode in parallel
+struct ViterbiDecoder {
+    void *handle = create_viterbi29(32);
+    ~ViterbiDecoder() { delete_viterbi29(handle); }
+};
+static thread_local ViterbiDecoder viterbi;
+
 void init_transponders() {
-    viterbi_decoder = create_viterbi29(32);
+    (void)viterbi.handle; // allocate the calling thread's trellis up front
 }
 
 int decode_openstint(const uint8_t *softbits, uint32_t *transponder_id) {
     uint8_t decoded[4];
+    void *viterbi_decoder = viterbi.handle;
 
     init_viterbi29(viterbi_decoder, 0);
     update_viterbi29_blk(viterbi_decoder, const_cast<uint8_t*>(softbits), 32+8); // khm...
@@ -105,6 +112,49 @@ int decode_rc3(const uint8_t *softbits, uint32_t *transponder_id, uint8_t *statu
     return (trail == 0);
 }
 
+void encode_openstint(uint32_t message, uint8_t *softbits) {
+    // <message[23:16]> <message[15:8]> <message[7:0]> <crc8> 0x00, see docs/transponder-protocol.md
+    uint8_t data[5] = {
+        static_cast<uint8_t>(message >> 16),
+        static_cast<uint8_t>(message >> 8),
+        static_cast<uint8_t>(message),
+        0, 0
+    };
+    data[3] = static_cast<uint8_t>(crc_generate_key(crc8_scheme, data, 3));
+
+    // K=9, r=1/2 convolutional encoder (libfec's viterbi29 polynomials)
+    uint32_t shreg = 0;
+    for (int i = 0; i < 40; i++) {
+        shreg = (shreg << 1) | ((data[i / 8] >> (7 - i % 8)) & 1);
+        softbits[2*i+0] = (std::popcount(shreg & V29POLYA) % 2) ? 255 : 0;
+        softbits[2*i+1] = (std::popcount(shreg & V29POLYB) % 2) ? 255 : 0;
+    }
+}
+
+void encode_rc3(uint32_t transponder_id, uint8_t status_code, uint8_t *softbits) {
+    // interleave: every 4th message bit is a status bit, see decode_rc3()
+    uint32_t message = 0;
+    int tid_bit = 23, status_bit = 7;
+    for (int i = 0; i < 32; i++) {
+        uint32_t bit = (i % 4 != 0)
+            ? (transponder_id >> (tid_bit--)) & 1
+            : (status_code >> (status_bit--)) & 1;
+        message |= bit << i;
+    }
+
+    // the message is shifted in MSB first, followed by 8 zero bits
+    uint32_t shreg = 0;
+    int prev = 0; // differential encoder, last preamble bit is 0
+    for (int k = 0; k < 40; k++) {
+        uint32_t u = (k < 32) ? (message >> (31 - k)) & 1 : 0;
+        shreg = (shreg << 1) | u;
+        prev ^= std::popcount(shreg & 0xEEC20F) % 2;
+        softbits[2*k+0] = prev ? 255 : 0;
+        prev ^= std::popcount(shreg & 0xEEC20D) % 2;
+        softbits[2*k+1] = prev ? 255 : 0;
+    }
+}
+
 void AmbRcBlacklist::process(uint64_t timestamp, uint8_t status_code, uint32_t transponder_id) {
     // not a candidate status/validation message:
     if ((status_code & 0xf8) != 0xf8) return; // not an AmbRc message
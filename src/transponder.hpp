@@ -25,12 +25,13 @@ constexpr std::array<float, PREAMBLE_LENGTH> preamble_symbols(uint16_t word) {
 }
 
 // upsample the ±1 preamble to the sample rate (np.repeat(pre, sps))
-constexpr std::array<float, PREAMBLE_LENGTH * SAMPLES_PER_SYMBOL> preamble_upsampled(uint16_t word) {
-    std::array<float, PREAMBLE_LENGTH * SAMPLES_PER_SYMBOL> up{};
+template<int SPS>
+constexpr std::array<float, PREAMBLE_LENGTH * SPS> preamble_upsampled(uint16_t word) {
+    std::array<float, PREAMBLE_LENGTH * SPS> up{};
     const auto syms = preamble_symbols(word);
     for (int i = 0; i < PREAMBLE_LENGTH; i++) {
-        for (int s = 0; s < SAMPLES_PER_SYMBOL; s++) {
-            up[i * SAMPLES_PER_SYMBOL + s] = syms[i];
+        for (int s = 0; s < SPS; s++) {
+            up[i * SPS + s] = syms[i];
         }
     }
     return up;
@@ -42,17 +43,20 @@ struct TransponderProps {
     std::size_t payload_size;
     std::string_view prefix;
     std::array<float, PREAMBLE_LENGTH> preamble_syms;
-    std::array<float, PREAMBLE_LENGTH * SAMPLES_PER_SYMBOL> preamble_up;
 };
 
 void init_transponders();
 int decode_openstint(const uint8_t *softbits, uint32_t *transponder_id);
 int decode_rc3(const uint8_t *softbits, uint32_t *transponder_id, uint8_t *status_code);
+// inverse of the decoders: message -> 80 hard-decision softbits (0 or 255), as
+// transmitted after the preamble (RC3 is differential-encoded, OpenStint is not)
+void encode_openstint(uint32_t message, uint8_t *softbits);
+void encode_rc3(uint32_t transponder_id, uint8_t status_code, uint8_t *softbits);
 
 inline constexpr TransponderProps TRANSPONDER_PROPERTIES[] = {
-    {0x857c, 0xf9a8, 80, "OPN", preamble_symbols(0xf9a8), preamble_upsampled(0xf9a8)},
-    {0x7916, 0x51e4, 80, "RC3", preamble_symbols(0x51e4), preamble_upsampled(0x51e4)},
-    {0xc0ab, 0x80cd, 100, "RC4", preamble_symbols(0x80cd), preamble_upsampled(0x80cd)}
+    {0x857c, 0xf9a8, 80, "OPN", preamble_symbols(0xf9a8)},
+    {0x7916, 0x51e4, 80, "RC3", preamble_symbols(0x51e4)},
+    {0xc0ab, 0x80cd, 100, "RC4", preamble_symbols(0x80cd)}
 };
 
 constexpr TransponderProps transponder_props(TransponderProtocol t) {